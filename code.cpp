@@ -5,6 +5,47 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <charconv>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+#include <limits>
+#include <list>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <queue>
+#include <array>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <random>
+#include <filesystem>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 using namespace std;
 
 // ================= ANSI Color Codes =================
@@ -25,14 +66,33 @@ string toUpperCase(const string &s) {
     return result;
 }
 
+// Parses "lat,lon" in decimal degrees.
+bool parseCoords(const string &s, double &lat, double &lon) {
+    size_t comma = s.find(',');
+    if (comma == string::npos) return false;
+    char *end = nullptr;
+    lat = strtod(s.c_str(), &end);
+    if (end != s.c_str() + comma) return false;
+    lon = strtod(s.c_str() + comma + 1, &end);
+    if (*end != '\0') return false;
+    return lat >= -90 && lat <= 90 && lon >= -180 && lon <= 180;
+}
+
 // ================= Property Class =================
 class Property {
 public:
     string type;
     string location;
-    int price;
-    int area;
+    int price = 0;
+    int area = 0;
     string owner;
+    bool hasCoords = false; // explicit coordinates; otherwise the gazetteer is used
+    double lat = 0, lon = 0;
+    string description;     // free text, persisted in descriptions.csv
+    long long descOffset = -1; // >= 0: description paged out to the cold store
+    unsigned descLength = 0;
+    int id = 0;             // stable listing id, 0 until assigned
+    bool deleted = false;   // tombstone; the row is dropped at compaction
 
     void input(const string &username) {
         cout << WHITE << "Enter property type (House/Apartment/Plot): " << RESET;
@@ -49,6 +109,15 @@ public:
         cout << WHITE << "Enter area (in sq.ft): " << RESET;
         cin >> area;
 
+        string coords;
+        cout << WHITE << "Enter coordinates as lat,lon (or - to use the city centre): " << RESET;
+        cin >> coords;
+        hasCoords = parseCoords(coords, lat, lon);
+
+        cout << WHITE << "Enter description (amenities, floor, facing; optional): " << RESET;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        getline(cin, description);
+
         owner = username;
     }
 
@@ -62,80 +131,4831 @@ public:
     }
 };
 
-// ================= User Class =================
-class User {
+// ================= CSV Streaming Pipeline =================
+// Bounded, blocking queue between pipeline stages. A full queue blocks the
+// producer, so a slow stage throttles the ones before it (backpressure).
+template <typename T>
+class BoundedQueue {
+private:
+    deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    mutex m;
+    condition_variable notFull, notEmpty;
+
 public:
-    string username;
-    string password;
-    User(string u, string p) : username(u), password(p) {}
-    User() {}
+    explicit BoundedQueue(size_t cap) : capacity(cap) {}
+
+    void push(T item) {
+        unique_lock<mutex> lock(m);
+        notFull.wait(lock, [&] { return items.size() < capacity || closed; });
+        if (closed) return;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    // Returns false once the queue is closed and drained.
+    bool pop(T &out) {
+        unique_lock<mutex> lock(m);
+        notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        out = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(m);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
 };
 
-// ================= RealEstate Class =================
-class RealEstate {
+// ================= Content Hashing =================
+string trimmed(const string &s) {
+    size_t b = s.find_first_not_of(" \t"), e = s.find_last_not_of(" \t");
+    return b == string::npos ? string() : s.substr(b, e - b + 1);
+}
+
+// 64-bit hash of the normalized record (type, location, price, area,
+// owner): FNV-1a over the fields followed by a splitmix finalizer.
+uint64_t contentHash(const Property &p) {
+    string key = toUpperCase(trimmed(p.type)) + '\x1f' + toUpperCase(trimmed(p.location)) + '\x1f' +
+                 to_string(p.price) + '\x1f' + to_string(p.area) + '\x1f' + trimmed(p.owner);
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h ? h : 1; // 0 marks an empty slot below
+}
+
+// Confirms a contentHash match field by field, so a collision never
+// merges two distinct listings.
+bool sameContent(const Property &a, const Property &b) {
+    return a.price == b.price && a.area == b.area && trimmed(a.owner) == trimmed(b.owner) &&
+           toUpperCase(trimmed(a.type)) == toUpperCase(trimmed(b.type)) &&
+           toUpperCase(trimmed(a.location)) == toUpperCase(trimmed(b.location));
+}
+
+// Open-addressing hash -> row map (linear probing, 12 bytes a slot, at
+// most half full) used to spot identical listings.
+class DedupIndex {
 private:
-    vector<Property> properties;
-    vector<User> users;
-    const string userFile = "users.csv";
-    const string propertyFile = "properties.csv";
+    vector<uint64_t> keys;
+    vector<int> rows;
+    size_t count = 0;
+
+    size_t mask() const { return keys.size() - 1; }
+
+    void grow() {
+        // Swap in the larger (empty) arrays, then re-insert the old slots.
+        vector<uint64_t> oldKeys(keys.empty() ? 16 : keys.size() * 2, 0);
+        vector<int> oldRows(oldKeys.size(), -1);
+        oldKeys.swap(keys);
+        oldRows.swap(rows);
+        count = 0;
+        for (size_t i = 0; i < oldKeys.size(); i++)
+            if (oldKeys[i]) insert(oldKeys[i], oldRows[i]);
+    }
+
+public:
+    void clear() {
+        keys.clear();
+        rows.clear();
+        count = 0;
+    }
+
+    int find(uint64_t h) const {
+        if (keys.empty()) return -1;
+        for (size_t i = h & mask(); keys[i]; i = (i + 1) & mask())
+            if (keys[i] == h) return rows[i];
+        return -1;
+    }
+
+    // Keeps the existing row if the hash is already present.
+    void insert(uint64_t h, int row) {
+        if ((count + 1) * 2 > keys.size()) grow();
+        size_t i = h & mask();
+        for (; keys[i]; i = (i + 1) & mask())
+            if (keys[i] == h) return;
+        keys[i] = h;
+        rows[i] = row;
+        count++;
+    }
+
+    // Removes the entry if it maps to this row, shifting later entries of
+    // the probe run back so lookups never stop early.
+    void erase(uint64_t h, int row) {
+        if (keys.empty()) return;
+        size_t i = h & mask();
+        for (; keys[i] && keys[i] != h; i = (i + 1) & mask()) {}
+        if (!keys[i] || rows[i] != row) return;
+        keys[i] = 0;
+        count--;
+        for (size_t j = (i + 1) & mask(); keys[j]; j = (j + 1) & mask()) {
+            size_t home = keys[j] & mask();
+            if (((j - home) & mask()) >= ((j - i) & mask())) {
+                keys[i] = keys[j];
+                rows[i] = rows[j];
+                keys[j] = 0;
+                i = j;
+            }
+        }
+    }
+};
+
+struct CsvRow {
+    size_t lineNo = 0;
+    string text;
+    Property p;
+    string error;
+    uint64_t hash = 0; // contentHash, filled in by the validate stage
+};
+
+struct ImportReport {
+    static const size_t MAX_SAMPLES = 20;
+    size_t accepted = 0;
+    size_t rejected = 0;
+    vector<string> samples; // "line N: reason" for the first few rejects
+
+    void reject(const CsvRow &row) {
+        rejected++;
+        if (samples.size() < MAX_SAMPLES)
+            samples.push_back("line " + to_string(row.lineNo) + ": " + row.error + " [" + row.text + "]");
+    }
+};
+
+bool parseInt(const string &s, int &out) {
+    if (s.empty()) return false;
+    char *end = nullptr;
+    errno = 0;
+    long v = strtol(s.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || v < INT_MIN || v > INT_MAX) return false;
+    out = (int)v;
+    return true;
+}
+
+// Splits one CSV line into a Property. Columns are
+// type,location,price,area,owner[,lat,lon[,id]]; anything after is ignored.
+bool parsePropertyLine(CsvRow &row) {
+    stringstream ss(row.text);
+    string priceStr, areaStr;
+    getline(ss, row.p.type, ',');
+    getline(ss, row.p.location, ',');
+    getline(ss, priceStr, ',');
+    getline(ss, areaStr, ',');
+    getline(ss, row.p.owner, ',');
+    if (!parseInt(priceStr, row.p.price)) { row.error = "bad price"; return false; }
+    if (!parseInt(areaStr, row.p.area)) { row.error = "bad area"; return false; }
+
+    string latStr, lonStr;
+    getline(ss, latStr, ',');
+    getline(ss, lonStr, ',');
+    if (!latStr.empty() || !lonStr.empty()) {
+        if (!parseCoords(latStr + "," + lonStr, row.p.lat, row.p.lon)) { row.error = "bad coordinates"; return false; }
+        row.p.hasCoords = true;
+    }
+
+    string idStr;
+    getline(ss, idStr, ',');
+    if (!idStr.empty() && (!parseInt(idStr, row.p.id) || row.p.id <= 0)) { row.error = "bad id"; return false; }
+    return true;
+}
+
+// Replaces `to` with `from`; std::rename does not overwrite on Windows.
+bool replaceFile(const string &from, const string &to) {
+#ifdef _WIN32
+    remove(to.c_str());
+#endif
+    return rename(from.c_str(), to.c_str()) == 0;
+}
+
+// Writes or appends `size` bytes and forces them to the device before
+// returning (fsync; _commit on Windows). Rewrites are text mode, appends
+// binary.
+bool writeFileSynced(const string &path, const char *data, size_t size, bool append) {
+#ifdef _WIN32
+    FILE *f = fopen(path.c_str(), append ? "ab" : "w");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size && fflush(f) == 0 && _commit(_fileno(f)) == 0;
+    return fclose(f) == 0 && ok;
+#else
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t off = 0; ok && off < size;) {
+        ssize_t n = write(fd, data + off, size - off);
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) off += n;
+    }
+    ok = ok && fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+#endif
+}
+
+// Makes a rename inside the directory holding `path` durable. POSIX only:
+// there the new directory entry is not on disk until the directory is
+// synced.
+void syncParentDir(const string &path) {
+#ifndef _WIN32
+    string dir = filesystem::path(path).parent_path().string();
+    int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+bool validateProperty(CsvRow &row) {
+    if (row.p.type.empty()) { row.error = "missing type"; return false; }
+    if (row.p.location.empty()) { row.error = "missing location"; return false; }
+    if (row.p.price < 0) { row.error = "negative price"; return false; }
+    if (row.p.area < 0) { row.error = "negative area"; return false; }
+    return true;
+}
+
+// reader -> parse -> validate -> sink, one thread per stage. Rows travel in
+// batches through bounded queues, so memory stays bounded by
+// QUEUE_DEPTH * BATCH_SIZE lines whatever the file size.
+ImportReport streamProperties(const string &path, const function<void(CsvRow &)> &sink) {
+    const size_t BATCH_SIZE = 1024, QUEUE_DEPTH = 8;
+    typedef vector<CsvRow> Batch;
+    ImportReport report;
+    ifstream fin(path);
+    if (!fin) return report;
+
+    BoundedQueue<Batch> rawQ(QUEUE_DEPTH), parsedQ(QUEUE_DEPTH), validQ(QUEUE_DEPTH);
+
+    thread reader([&] {
+        string line;
+        size_t lineNo = 0;
+        Batch batch;
+        while (getline(fin, line)) {
+            lineNo++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            CsvRow row;
+            row.lineNo = lineNo;
+            row.text = std::move(line);
+            batch.push_back(std::move(row));
+            if (batch.size() == BATCH_SIZE) {
+                rawQ.push(std::move(batch));
+                batch.clear();
+            }
+        }
+        if (!batch.empty()) rawQ.push(std::move(batch));
+        rawQ.close();
+    });
+
+    thread parser([&] {
+        Batch batch;
+        while (rawQ.pop(batch)) {
+            for (auto &row : batch) parsePropertyLine(row);
+            parsedQ.push(std::move(batch));
+        }
+        parsedQ.close();
+    });
+
+    thread validator([&] {
+        Batch batch;
+        while (parsedQ.pop(batch)) {
+            for (auto &row : batch)
+                if (row.error.empty() && validateProperty(row))
+                    row.hash = contentHash(row.p);
+            validQ.push(std::move(batch));
+        }
+        validQ.close();
+    });
+
+    Batch batch;
+    while (validQ.pop(batch)) {
+        for (auto &row : batch) {
+            if (!row.error.empty()) {
+                report.reject(row);
+                continue;
+            }
+            sink(row);
+            report.accepted++;
+        }
+    }
+
+    reader.join();
+    parser.join();
+    validator.join();
+    return report;
+}
+
+// Buffered CSV writer: rows are formatted into a large in-memory buffer and
+// written out in big chunks instead of one stream insertion per field.
+class CsvWriter {
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    ofstream fout;
+    string buffer;
+
+    static void appendInt(string &out, int v) {
+        char tmp[16];
+        auto res = to_chars(tmp, tmp + sizeof(tmp), v);
+        out.append(tmp, res.ptr);
+    }
+
+public:
+    size_t rows = 0;
+
+    explicit CsvWriter(const string &path) : fout(path) {
+        buffer.reserve(BUFFER_SIZE + 4096);
+    }
+    ~CsvWriter() { flush(); }
+
+    bool ok() const { return (bool)fout; }
+
+    // type,location,price,area,owner,lat,lon,id plus newline.
+    static void appendRow(string &out, const Property &p) {
+        out += p.type;
+        out += ',';
+        out += p.location;
+        out += ',';
+        appendInt(out, p.price);
+        out += ',';
+        appendInt(out, p.area);
+        out += ',';
+        out += p.owner;
+        if (p.hasCoords) {
+            char tmp[48];
+            out.append(tmp, snprintf(tmp, sizeof(tmp), ",%.6f,%.6f", p.lat, p.lon));
+        } else {
+            out += ",,";
+        }
+        out += ',';
+        appendInt(out, p.id);
+        out += '\n';
+    }
+
+    void write(const Property &p) {
+        appendRow(buffer, p);
+        rows++;
+        if (buffer.size() >= BUFFER_SIZE) flush();
+    }
+
+    // False once a write has failed.
+    bool flush() {
+        if (!buffer.empty()) {
+            fout.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+        fout.flush();
+        return ok();
+    }
+};
+
+// ================= Persistence Worker =================
+// Crash simulation for --fault-test. Every file step the worker takes (a
+// write or a rename) goes through allow(). Once `stepsLeft` steps have
+// been taken the process counts as dead: the step that uses up the last
+// one lands only its first `tornBytes` bytes, and nothing after it
+// reaches the disk.
+struct FaultInjection {
+    long stepsLeft = -1; // -1: off
+    size_t tornBytes = 0;
+    long steps = 0; // file steps taken so far
+
+    // False if the step must not happen; on the crashing step `bytes` is
+    // cut to what lands.
+    bool allow(size_t &bytes) {
+        if (stepsLeft == 0) return false;
+        steps++;
+        if (stepsLeft > 0 && --stepsLeft == 0) bytes = min(bytes, tornBytes);
+        return true;
+    }
+};
+
+FaultInjection faultInjection; // only touched while no writes are queued
+
+// File writes run on one background thread so the menus never wait on the
+// disk. A job is one or more file writes performed in order, and jobs run
+// in submission order. A job that repeats the one at the back of the queue
+// is folded into it instead (rewrites replace the queued data, appends
+// extend it), so a burst of saves costs one write while the disk still
+// only ever sees states the program actually passed through. Every write
+// is synced to the device before the next one starts. Rewrites go to
+// "<path>.tmp", which is synced, renamed over the target and followed by
+// a sync of the directory, so a crash or power cut leaves the old file or
+// the new one, never half of one.
+class PersistenceWorker {
+public:
+    struct Write {
+        string path;
+        string data;
+        bool append;
+    };
+
+private:
+    const size_t capacity;
+    deque<vector<Write>> jobs;
+    bool writing = false, stopping = false;
+    mutex m;
+    condition_variable changed;
+    thread worker;
+
+    // Appends carry binary journal records, hence binary mode.
+    static bool perform(const Write &w) {
+        size_t n = w.data.size();
+        if (!faultInjection.allow(n)) return false;
+        if (w.append) return writeFileSynced(w.path, w.data.data(), n, true) && n == w.data.size();
+        string tmp = w.path + ".tmp";
+        if (!writeFileSynced(tmp, w.data.data(), n, false) || n < w.data.size()) return false;
+        size_t none = 0;
+        if (!faultInjection.allow(none) || !replaceFile(tmp, w.path)) return false;
+        syncParentDir(w.path);
+        return true;
+    }
+
+    static bool sameShape(const vector<Write> &a, const vector<Write> &b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (a[i].path != b[i].path || a[i].append != b[i].append) return false;
+        return true;
+    }
+
+    void run() {
+        unique_lock<mutex> lock(m);
+        while (true) {
+            changed.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return; // stopping, and drained
+            vector<Write> job = std::move(jobs.front());
+            jobs.pop_front();
+            writing = true;
+            changed.notify_all();
+            lock.unlock();
+            for (auto &w : job)
+                if (!perform(w)) {
+                    cerr << "Could not write " << w.path << "\n";
+                    break;
+                }
+            lock.lock();
+            writing = false;
+            changed.notify_all();
+        }
+    }
+
+public:
+    explicit PersistenceWorker(size_t maxJobs = 64) : capacity(maxJobs) {
+        worker = thread([this] { run(); });
+    }
+
+    // Drains everything still queued before returning.
+    ~PersistenceWorker() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+
+    void submit(vector<Write> job) {
+        unique_lock<mutex> lock(m);
+        if (!jobs.empty() && sameShape(jobs.back(), job)) {
+            vector<Write> &last = jobs.back();
+            for (size_t i = 0; i < job.size(); i++) {
+                if (job[i].append) last[i].data += job[i].data;
+                else last[i].data = std::move(job[i].data);
+            }
+            return;
+        }
+        changed.wait(lock, [this] { return jobs.size() < capacity; });
+        jobs.push_back(std::move(job));
+        changed.notify_all();
+    }
+
+    void rewrite(const string &path, string data) { submit({{path, std::move(data), false}}); }
+    void append(const string &path, string data) { submit({{path, std::move(data), true}}); }
+
+    // Blocks until every write submitted so far is on disk.
+    void flush() {
+        unique_lock<mutex> lock(m);
+        changed.wait(lock, [this] { return jobs.empty() && !writing; });
+    }
+};
+
+// ================= Record Log =================
+// The journal is a sequence of framed records, little-endian:
+//   u32 payload length | u32 crc32(generation, payload) | u32 generation | payload
+// A crash can only tear the record being appended, so recovery reads
+// forward until the first frame that is short or fails its checksum and
+// drops everything from there on.
+const size_t RECORD_HEADER = 12;
+const uint32_t MAX_RECORD = 1 << 20;
+
+uint32_t crc32(const char *data, size_t n, uint32_t crc = 0) {
+    static const auto table = [] {
+        array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++)
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putU32(string &out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out += (char)((v >> (8 * i)) & 0xFF);
+}
+
+uint32_t getU32(const char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | (unsigned char)p[i];
+    return v;
+}
+
+string encodeRecord(uint32_t generation, const string &payload) {
+    string out;
+    putU32(out, (uint32_t)payload.size());
+    string body;
+    putU32(body, generation);
+    body += payload;
+    putU32(out, crc32(body.data(), body.size()));
+    return out + body;
+}
+
+struct LogRecord {
+    uint32_t generation;
+    string payload;
+};
+
+// Decodes the valid prefix of `bytes` into `out` and returns its length.
+size_t decodeRecords(const string &bytes, vector<LogRecord> &out) {
+    size_t pos = 0;
+    while (bytes.size() - pos >= RECORD_HEADER) {
+        uint32_t len = getU32(bytes.data() + pos);
+        if (len > MAX_RECORD || bytes.size() - pos - RECORD_HEADER < len) break;
+        const char *body = bytes.data() + pos + 8;
+        if (crc32(body, len + 4) != getU32(bytes.data() + pos + 4)) break;
+        out.push_back({getU32(body), string(body + 4, len)});
+        pos += RECORD_HEADER + len;
+    }
+    return pos;
+}
+
+// The manifest names the snapshot generation the journal applies to. A
+// snapshot is written as descriptions, property file, manifest, then an
+// empty journal, so records tagged with an older generation (already in
+// the property file) are recognisable and skipped. If the crash falls
+// between the property file and the manifest, the journal's records are
+// replayed onto the newer file; replay is idempotent, so that is harmless.
+struct Manifest {
+    bool present = false;
+    uint32_t generation = 0;
+    uint32_t crc = 0; // of the property file as written
+    size_t rows = 0;
+    int nextId = 1; // ids of deleted listings are never handed out again
+
+    static Manifest load(const string &path) {
+        Manifest m;
+        ifstream fin(path);
+        string key;
+        while (fin >> key) {
+            if (key == "generation") fin >> m.generation;
+            else if (key == "crc") fin >> hex >> m.crc >> dec;
+            else if (key == "rows") fin >> m.rows;
+            else if (key == "next_id") fin >> m.nextId;
+            m.present = true;
+        }
+        return m;
+    }
+
+    string format() const {
+        char tmp[128];
+        snprintf(tmp, sizeof(tmp), "generation %u\ncrc %08x\nrows %zu\nnext_id %d\n", generation, crc, rows, nextId);
+        return tmp;
+    }
+};
+
+// Reads a whole file (text or binary); empty if it does not exist.
+string readFile(const string &path, bool binary) {
+    ifstream fin(path, binary ? ios::in | ios::binary : ios::in);
+    stringstream ss;
+    ss << fin.rdbuf();
+    return ss.str();
+}
+
+// Appends random records to an in-memory log, kills the write at a random
+// offset (optionally flipping a byte in the torn region) and checks that
+// decoding returns exactly a prefix of what was written. Returns the
+// number of failed rounds.
+int fuzzRecordDecoding(int rounds) {
+    srand(12345);
+    int failures = 0;
+    for (int round = 0; round < rounds; round++) {
+        vector<LogRecord> written;
+        string log;
+        vector<size_t> ends; // byte offset after each record
+        int count = 1 + rand() % 64;
+        for (int i = 0; i < count; i++) {
+            LogRecord r{(uint32_t)(rand() % 3), string(rand() % 200, 'a' + rand() % 26)};
+            log += encodeRecord(r.generation, r.payload);
+            written.push_back(r);
+            ends.push_back(log.size());
+        }
+        size_t cut = rand() % (log.size() + 1);
+        string torn = log.substr(0, cut);
+        if (!torn.empty() && rand() % 2) torn[rand() % torn.size()] ^= (char)(1 + rand() % 255);
+
+        vector<LogRecord> recovered;
+        size_t valid = decodeRecords(torn, recovered);
+        bool ok = valid <= cut && recovered.size() <= written.size() &&
+                  (recovered.empty() ? valid == 0 : valid == ends[recovered.size() - 1]);
+        for (size_t i = 0; ok && i < recovered.size(); i++)
+            ok = recovered[i].generation == written[i].generation && recovered[i].payload == written[i].payload;
+        // With no corruption every record that fully landed must come back.
+        if (ok && torn == log.substr(0, cut))
+            ok = recovered.size() == (size_t)(upper_bound(ends.begin(), ends.end(), cut) - ends.begin());
+        if (!ok) {
+            failures++;
+            cout << RED << "Round " << round << ": decoding returned a non-prefix (cut at " << cut << ")\n" << RESET;
+        }
+    }
+    return failures;
+}
+
+// ================= Memory Placement =================
+// Optional placement for the large column arrays.
+//  - --hugepages thp: allocations of HUGE_PAGE bytes or more are mmap'd on
+//    a 2 MiB boundary and marked MADV_HUGEPAGE, so the kernel can back them
+//    with transparent huge pages.
+//  - --hugepages explicit: they come from the reserved hugetlbfs pool
+//    (MAP_HUGETLB), falling back to THP when the pool is empty.
+// One TLB entry then covers 2 MiB of a column instead of 4 KiB. NUMA
+// placement uses the kernel's first-touch policy (no libnuma): memory
+// lands on the node of the thread that first writes it, so with --numa
+// each in-process shard runs on a worker pinned to a node and builds its
+// rows there. Only the fixed-size part of a row is placed this way:
+// strings too long for their inline buffer (descriptions, mostly) come
+// from the default heap. Other platforms get plain heap memory and no
+// pinning.
+enum HugePageMode { HUGEPAGES_OFF, HUGEPAGES_THP, HUGEPAGES_EXPLICIT };
+
+struct MemoryConfig {
+    HugePageMode hugePages = HUGEPAGES_OFF;
+    bool numa = false; // pin shard workers to nodes round-robin
+};
+
+MemoryConfig memoryConfig;
+
+const size_t HUGE_PAGE = 2 << 20;
+
+inline size_t hugeRound(size_t bytes) { return (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1); }
+
+void *allocateColumn(size_t bytes, HugePageMode mode) {
+#ifdef __linux__
+    if (mode != HUGEPAGES_OFF && bytes >= HUGE_PAGE) {
+        size_t len = hugeRound(bytes);
+        void *p = MAP_FAILED;
+        if (mode == HUGEPAGES_EXPLICIT)
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) return p;
+        // Map one huge page extra so the start can be aligned, then trim.
+        size_t span = len + HUGE_PAGE;
+        char *raw = (char *)mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw bad_alloc();
+        char *start = (char *)(((uintptr_t)raw + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+        if (start > raw) munmap(raw, start - raw);
+        if (raw + span > start + len) munmap(start + len, raw + span - (start + len));
+        madvise(start, len, MADV_HUGEPAGE);
+        return start;
+    }
+#else
+    (void)mode;
+#endif
+    return ::operator new(bytes);
+}
+
+void freeColumn(void *p, size_t bytes, HugePageMode mode) {
+#ifdef __linux__
+    if (mode != HUGEPAGES_OFF && bytes >= HUGE_PAGE) {
+        munmap(p, hugeRound(bytes));
+        return;
+    }
+#else
+    (void)bytes, (void)mode;
+#endif
+    ::operator delete(p);
+}
+
+// Allocator for column arrays. It captures the mode when constructed, so
+// an array is always freed the way it was allocated.
+template <typename T>
+struct ColumnAllocator {
+    typedef T value_type;
+    HugePageMode mode = memoryConfig.hugePages;
+
+    ColumnAllocator() = default;
+    template <typename U>
+    ColumnAllocator(const ColumnAllocator<U> &other) : mode(other.mode) {}
+
+    T *allocate(size_t n) { return (T *)allocateColumn(n * sizeof(T), mode); }
+    void deallocate(T *p, size_t n) { freeColumn(p, n * sizeof(T), mode); }
+
+    template <typename U>
+    bool operator==(const ColumnAllocator<U> &other) const { return mode == other.mode; }
+    template <typename U>
+    bool operator!=(const ColumnAllocator<U> &other) const { return mode != other.mode; }
+};
+
+template <typename T>
+using ColumnArray = vector<T, ColumnAllocator<T>>;
+
+// CPUs of each NUMA node, from sysfs; a single node with every CPU when
+// the topology is not exposed.
+vector<vector<int>> numaNodes() {
+    vector<vector<int>> nodes;
+#ifdef __linux__
+    for (int n = 0;; n++) {
+        ifstream fin("/sys/devices/system/node/node" + to_string(n) + "/cpulist");
+        string list;
+        if (!getline(fin, list)) break;
+        vector<int> cpus;
+        stringstream ss(list);
+        for (string range; getline(ss, range, ',');) {
+            int lo, hi;
+            size_t dash = range.find('-');
+            if (!parseInt(range.substr(0, dash), lo)) continue;
+            if (dash == string::npos || !parseInt(range.substr(dash + 1), hi)) hi = lo;
+            for (int c = lo; c <= hi; c++) cpus.push_back(c);
+        }
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.emplace_back();
+        for (int c = 0; c < (int)max(1u, thread::hardware_concurrency()); c++) nodes[0].push_back(c);
+    }
+    return nodes;
+}
+
+// Restricts the calling thread to the CPUs of node % (node count).
+bool pinToNode(int node) {
+#ifdef __linux__
+    static const vector<vector<int>> nodes = numaNodes();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : nodes[node % nodes.size()]) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+// A thread that runs posted tasks in order, optionally pinned to a NUMA
+// node so that whatever it allocates and touches stays node-local.
+class PinnedWorker {
+private:
+    mutex m;
+    condition_variable ready;
+    deque<function<void()>> tasks;
+    bool stopping = false;
+    thread worker;
+
+public:
+    explicit PinnedWorker(int node = -1) {
+        worker = thread([this, node] {
+            if (node >= 0) pinToNode(node);
+            unique_lock<mutex> lock(m);
+            for (;;) {
+                ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                function<void()> task = std::move(tasks.front());
+                tasks.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        });
+    }
+
+    ~PinnedWorker() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        ready.notify_one();
+        worker.join(); // drains what was posted first
+    }
+
+    void post(function<void()> task) {
+        {
+            lock_guard<mutex> lock(m);
+            tasks.push_back(std::move(task));
+        }
+        ready.notify_one();
+    }
+
+    // Runs fn on the worker after everything posted before it.
+    template <typename Fn>
+    auto call(Fn fn) -> decltype(fn()) {
+        packaged_task<decltype(fn())()> task(std::move(fn));
+        auto result = task.get_future();
+        post([&task] { task(); });
+        return result.get();
+    }
+};
+
+// Counts dTLB read misses in user space for the creating thread and every
+// thread it starts afterwards (their counts fold in when they exit).
+// ok() is false where perf events are not permitted.
+class TlbMissCounter {
+private:
+    int fd = -1;
+
+public:
+    TlbMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~TlbMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool ok() const { return fd >= 0; }
+
+    void start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    long long stop() {
+        long long count = -1;
+#ifdef __linux__
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+        return count;
+    }
+};
+
+// Anonymous memory of this process currently backed by huge pages, in KiB.
+long long anonHugePagesKb() {
+    ifstream fin("/proc/self/smaps_rollup");
+    for (string line; getline(fin, line);)
+        if (line.rfind("AnonHugePages:", 0) == 0) return atoll(line.c_str() + 14);
+    return -1;
+}
+
+// ================= Geo Index =================
+// Bundled city centres for the locations we list, so proximity search
+// works offline for rows without explicit coordinates.
+struct GazetteerEntry {
+    const char *name;
+    double lat, lon;
+};
+
+const GazetteerEntry GAZETTEER[] = {
+    {"MUMBAI", 19.0760, 72.8777},     {"THANE", 19.2183, 72.9781},
+    {"PUNE", 18.5204, 73.8567},       {"PIMPRI", 18.6298, 73.7997},
+    {"CHINCHWAD", 18.6279, 73.8009},  {"LONAVALA", 18.7546, 73.4062},
+    {"BARAMATI", 18.1514, 74.5815},   {"NASHIK", 19.9975, 73.7898},
+    {"NASIK", 19.9975, 73.7898},      {"SANGLI", 16.8524, 74.5815},
+    {"MIRAJ", 16.8222, 74.6450},      {"KOLHAPUR", 16.7050, 74.2433},
+    {"ICHALKARANJI", 16.6913, 74.4605}, {"SATARA", 17.6805, 74.0183},
+    {"KARAD", 17.2890, 74.1818},      {"SOLAPUR", 17.6599, 75.9064},
+    {"AHMEDNAGAR", 19.0952, 74.7496}, {"AURANGABAD", 19.8762, 75.3433},
+    {"JALGAON", 21.0077, 75.5626},    {"NAGPUR", 21.1458, 79.0882},
+    {"AMRAVATI", 20.9374, 77.7796},   {"LATUR", 18.4088, 76.5604},
+    {"NANDED", 19.1383, 77.3210},     {"RATNAGIRI", 16.9902, 73.3120},
+    {"PANAJI", 15.4909, 73.8278},     {"BELGAUM", 15.8497, 74.4977},
+    {"DELHI", 28.7041, 77.1025},      {"BANGALORE", 12.9716, 77.5946},
+    {"BENGALURU", 12.9716, 77.5946},  {"HYDERABAD", 17.3850, 78.4867},
+    {"CHENNAI", 13.0827, 80.2707},    {"KOLKATA", 22.5726, 88.3639},
+    {"AHMEDABAD", 23.0225, 72.5714},  {"SURAT", 21.1702, 72.8311},
+};
+
+bool lookupCity(const string &name, double &lat, double &lon) {
+    string key = toUpperCase(name);
+    for (auto &e : GAZETTEER)
+        if (key == e.name) {
+            lat = e.lat;
+            lon = e.lon;
+            return true;
+        }
+    return false;
+}
+
+const double PI = 3.14159265358979323846;
+
+double haversineKm(double lat1, double lon1, double lat2, double lon2) {
+    const double R = 6371.0, RAD = PI / 180.0;
+    double dLat = (lat2 - lat1) * RAD, dLon = (lon2 - lon1) * RAD;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * RAD) * cos(lat2 * RAD) * sin(dLon / 2) * sin(dLon / 2);
+    return 2 * R * asin(sqrt(min(1.0, a)));
+}
+
+// Conjunction of optional type / location / price constraints shared by
+// the search paths.
+struct PropertyFilter {
+    string type;             // upper-cased, empty = any
+    string location;         // upper-cased, empty = any
+    int minPrice = INT_MIN;
+    int maxPrice = INT_MAX;
+    int minArea = INT_MIN;
+    int maxArea = INT_MAX;
+
+    bool matches(const Property &p) const {
+        return !p.deleted && (type.empty() || toUpperCase(p.type) == type) &&
+               (location.empty() || toUpperCase(p.location) == location) &&
+               p.price >= minPrice && p.price <= maxPrice && p.area >= minArea && p.area <= maxArea;
+    }
+
+    // Normalized form used as the cache key.
+    string key() const {
+        return type + "|" + location + "|" + to_string(minPrice) + "|" + to_string(maxPrice) + "|" +
+               to_string(minArea) + "|" + to_string(maxArea);
+    }
+};
+
+// Uniform lat/lon grid of row numbers. A query only visits the cells
+// overlapping its bounding box and checks the exact distance there.
+class GeoGrid {
+private:
+    static constexpr double CELL_DEG = 0.05; // ~5.5 km
+    unordered_map<long long, vector<int>> cells;
+    ColumnArray<double> rowLat, rowLon;
+    ColumnArray<char> located;
+
+    static long long cellOf(int latCell, int lonCell) {
+        return ((long long)latCell << 32) | (unsigned int)lonCell;
+    }
+    // Clamped first, so any input (NaN included) gives a cell in range.
+    static int toCell(double deg) { return (int)floor(min(180.0, max(-180.0, deg)) / CELL_DEG); }
+
+    typedef array<double, 4> Box; // minLat, minLon, maxLat, maxLon
+
+    // The box clamped to [-90, 90] x [-180, 180]. A longitude range that
+    // runs past +-180 wraps around the antimeridian and becomes two boxes;
+    // one spanning 360 degrees or more covers every longitude.
+    static vector<Box> normalize(double minLat, double minLon, double maxLat, double maxLon) {
+        minLat = max(minLat, -90.0), maxLat = min(maxLat, 90.0);
+        if (!isfinite(minLon) || !isfinite(maxLon) || !(minLat <= maxLat) || !(minLon <= maxLon)) return {};
+        if (maxLon - minLon >= 360) return {{minLat, -180, maxLat, 180}};
+        double shift = 360 * floor((minLon + 180) / 360); // minLon into [-180, 180)
+        minLon -= shift, maxLon -= shift;
+        if (maxLon <= 180) return {{minLat, minLon, maxLat, maxLon}};
+        return {{minLat, minLon, maxLat, 180}, {minLat, -180, maxLat, maxLon - 360}};
+    }
+
+    // Calls fn(rows) for each occupied cell overlapping a normalized box:
+    // probes the box's cells, or walks the occupied cells when there are
+    // fewer of those, so the work is bounded by the table either way.
+    template <typename Fn>
+    void forEachCell(const Box &box, Fn fn) const {
+        int a0 = toCell(box[0]), b0 = toCell(box[1]), a1 = toCell(box[2]), b1 = toCell(box[3]);
+        if ((double)(a1 - a0 + 1) * (b1 - b0 + 1) > cells.size()) {
+            for (auto &c : cells) {
+                int a = (int)(c.first >> 32), b = (int)(unsigned int)c.first;
+                if (a >= a0 && a <= a1 && b >= b0 && b <= b1) fn(c.second);
+            }
+            return;
+        }
+        for (int a = a0; a <= a1; a++)
+            for (int b = b0; b <= b1; b++) {
+                auto it = cells.find(cellOf(a, b));
+                if (it != cells.end()) fn(it->second);
+            }
+    }
+
+    // Bounding box of a circle on the haversine sphere: the widest point
+    // is asin(sin r / cos lat) away in longitude, and once the circle
+    // reaches a pole it takes every longitude.
+    static Box circleBox(double lat, double lon, double radiusKm) {
+        double angle = radiusKm / 6371.0, dLat = angle * 180 / PI;
+        if (lat - dLat <= -90 || lat + dLat >= 90) return {lat - dLat, -180, lat + dLat, 180};
+        double dLon = asin(min(1.0, sin(angle) / cos(lat * PI / 180))) * 180 / PI;
+        return {lat - dLat, lon - dLon, lat + dLat, lon + dLon};
+    }
+
+public:
+    // Half the equator: a larger circle already covers the whole globe.
+    static constexpr double MAX_RADIUS_KM = 20038;
+
+    static bool validRadius(double radiusKm) { return radiusKm > 0 && radiusKm <= MAX_RADIUS_KM; }
+
+    void clear() {
+        cells.clear();
+        rowLat.clear();
+        rowLon.clear();
+        located.clear();
+    }
+
+    // Rows must be added in order; rows with no known position are skipped.
+    void add(int row, const Property &p) {
+        double lat = p.lat, lon = p.lon;
+        bool ok = p.hasCoords || lookupCity(p.location, lat, lon);
+        rowLat.push_back(lat);
+        rowLon.push_back(lon);
+        located.push_back(ok);
+        if (ok) cells[cellOf(toCell(lat), toCell(lon))].push_back(row);
+    }
+
+    bool position(int row, double &lat, double &lon) const {
+        lat = rowLat[row];
+        lon = rowLon[row];
+        return located[row];
+    }
+
+    // Rows filed in the cells a box query would visit (an upper bound on
+    // what it checks).
+    size_t countInBox(double minLat, double minLon, double maxLat, double maxLon) const {
+        size_t n = 0;
+        for (const Box &box : normalize(minLat, minLon, maxLat, maxLon))
+            forEachCell(box, [&](const vector<int> &rows) { n += rows.size(); });
+        return n;
+    }
+
+    template <typename Visit>
+    void forEachInBox(double minLat, double minLon, double maxLat, double maxLon, Visit visit) const {
+        for (const Box &box : normalize(minLat, minLon, maxLat, maxLon))
+            forEachCell(box, [&](const vector<int> &rows) {
+                for (int row : rows)
+                    if (rowLat[row] >= box[0] && rowLat[row] <= box[2] && rowLon[row] >= box[1] && rowLon[row] <= box[3])
+                        visit(row);
+            });
+    }
+
+    // Work a withinRadius query does: the cells it probes plus the rows
+    // filed in them.
+    size_t costNear(double lat, double lon, double radiusKm) const {
+        if (!validRadius(radiusKm)) return 0;
+        Box circle = circleBox(lat, lon, radiusKm);
+        size_t n = countInBox(circle[0], circle[1], circle[2], circle[3]);
+        for (const Box &box : normalize(circle[0], circle[1], circle[2], circle[3])) {
+            double boxCells = (double)(toCell(box[2]) - toCell(box[0]) + 1) * (toCell(box[3]) - toCell(box[1]) + 1);
+            n += (size_t)min(boxCells, (double)cells.size());
+        }
+        return n;
+    }
+
+    // Rows within radiusKm, nearest first, as (distance, row); nothing for
+    // a radius outside (0, MAX_RADIUS_KM].
+    vector<pair<double, int>> withinRadius(double lat, double lon, double radiusKm) const {
+        vector<pair<double, int>> out;
+        if (!validRadius(radiusKm)) return out;
+        Box box = circleBox(lat, lon, radiusKm);
+        forEachInBox(box[0], box[1], box[2], box[3], [&](int row) {
+            double d = haversineKm(lat, lon, rowLat[row], rowLon[row]);
+            if (d <= radiusKm) out.push_back({d, row});
+        });
+        sort(out.begin(), out.end());
+        return out;
+    }
+
+    vector<int> withinBox(double minLat, double minLon, double maxLat, double maxLon) const {
+        vector<int> out;
+        forEachInBox(minLat, minLon, maxLat, maxLon, [&](int row) { out.push_back(row); });
+        sort(out.begin(), out.end());
+        return out;
+    }
+};
+
+// ================= Bloom Filters =================
+// Set membership with no false negatives: "no" is definite, "maybe" needs
+// the real lookup. Sized from the expected item count and target false-
+// positive rate (m = -n ln p / ln^2 2 bits, k = m/n ln 2 hashes), capped by
+// a byte budget; a capped filter just answers "maybe" more often.
+struct BloomConfig {
+    double fpRate = 0.01;
+    size_t zoneBytes = 2048; // per filter per zone
+};
+BloomConfig bloomConfig; // set from --bloom-fp / --bloom-bytes
+
+class BloomFilter {
+private:
+    vector<uint64_t> bits;
+    int hashes = 0;
+    size_t capacity = 0, count = 0;
+
+    static uint64_t hashOf(const string &key) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+public:
+    BloomFilter() {}
+    BloomFilter(size_t expected, double fpRate, size_t maxBytes = 0) : capacity(max<size_t>(expected, 1)) {
+        double ln2 = log(2.0);
+        double m = -(double)capacity * log(fpRate) / (ln2 * ln2);
+        size_t words = max<size_t>(1, (size_t)ceil(m / 64));
+        if (maxBytes) words = min(words, max<size_t>(1, maxBytes / 8));
+        bits.assign(words, 0);
+        hashes = (int)min(16.0, max(1.0, round(words * 64.0 / capacity * ln2)));
+    }
+
+    // Double hashing: probe i is h1 + i * h2.
+    void add(const string &key) {
+        if (bits.empty()) return;
+        uint64_t h = hashOf(key), h2 = (h >> 32) | 1, n = bits.size() * 64;
+        for (int i = 0; i < hashes; i++, h += h2)
+            bits[(h % n) >> 6] |= 1ULL << (h % n & 63);
+        count++;
+    }
+
+    // An unsized filter knows nothing and answers "maybe".
+    bool mayContain(const string &key) const {
+        if (bits.empty()) return true;
+        uint64_t h = hashOf(key), h2 = (h >> 32) | 1, n = bits.size() * 64;
+        for (int i = 0; i < hashes; i++, h += h2)
+            if (!(bits[(h % n) >> 6] >> (h % n & 63) & 1)) return false;
+        return true;
+    }
+
+    bool full() const { return count >= capacity; }
+    size_t bytes() const { return bits.size() * sizeof(uint64_t); }
+};
+
+// ================= Price per Sq.ft =================
+// Derived value column, kept as fixed point in hundredths of a rupee so
+// it can be compared, packed and indexed as an int:
+//   value = price * 100 / area, rounded half up, computed in 64 bits;
+//   area <= 0 (or a negative price) gives PPSF_NONE, which every value
+//   query skips; results above INT_MAX saturate to INT_MAX.
+const int PPSF_SCALE = 100;
+const int PPSF_NONE = -1;
+
+inline int pricePerSqft(int price, int area) {
+    if (area <= 0 || price < 0) return PPSF_NONE;
+    long long v = ((long long)price * PPSF_SCALE * 2 + area) / (2LL * area);
+    return (int)min<long long>(v, INT_MAX);
+}
+
+string formatPpsf(int v) {
+    if (v == PPSF_NONE) return "n/a";
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%d.%02d", v / PPSF_SCALE, v % PPSF_SCALE);
+    return tmp;
+}
+
+// Rows ordered by price per sq.ft: a sorted run plus an unsorted tail of
+// recent inserts, merged into the run once it reaches MERGE_AT entries, so
+// an insert costs O(1) amortised over the occasional O(n) merge and a
+// range query is two binary searches plus a pass over the tail. Rows with
+// PPSF_NONE are not indexed; tombstoned rows stay until the next rebuild,
+// so callers check liveness.
+class ValueIndex {
+public:
+    static const size_t MERGE_AT = 1024;
+
+private:
+    vector<pair<int, int>> run, tail; // (value, row)
+
+    void merge() {
+        size_t mid = run.size();
+        sort(tail.begin(), tail.end());
+        run.insert(run.end(), tail.begin(), tail.end());
+        inplace_merge(run.begin(), run.begin() + mid, run.end());
+        tail.clear();
+    }
+
+public:
+    void clear() {
+        run.clear();
+        tail.clear();
+    }
+
+    void add(int row, int value) {
+        if (value == PPSF_NONE) return;
+        tail.push_back({value, row});
+        if (tail.size() >= MERGE_AT) merge();
+    }
+
+    // Entries a scan of [lo, hi] would visit.
+    size_t countInRange(int lo, int hi) const {
+        size_t n = upper_bound(run.begin(), run.end(), make_pair(hi, INT_MAX)) -
+                   lower_bound(run.begin(), run.end(), make_pair(lo, INT_MIN));
+        for (auto &e : tail) n += e.first >= lo && e.first <= hi;
+        return n;
+    }
+
+    // Calls visit(value, row) for entries in [lo, hi], lowest value first,
+    // until it returns false.
+    template <typename Visit>
+    void scan(int lo, int hi, Visit visit) const {
+        vector<pair<int, int>> recent;
+        for (auto &e : tail)
+            if (e.first >= lo && e.first <= hi) recent.push_back(e);
+        sort(recent.begin(), recent.end());
+        auto a = lower_bound(run.begin(), run.end(), make_pair(lo, INT_MIN));
+        auto aEnd = upper_bound(a, run.end(), make_pair(hi, INT_MAX));
+        auto b = recent.begin();
+        while (a != aEnd || b != recent.end()) {
+            const pair<int, int> &e = (b == recent.end() || (a != aEnd && *a < *b)) ? *a++ : *b++;
+            if (!visit(e.first, e.second)) return;
+        }
+    }
+};
+
+// ================= Column Store =================
+// Maps each distinct string to a dense id.
+class Dictionary {
+private:
+    unordered_map<string, int> ids;
+    vector<string> values;
+
+public:
+    int encode(const string &v) {
+        auto it = ids.find(v);
+        if (it != ids.end()) return it->second;
+        ids.emplace(v, (int)values.size());
+        values.push_back(v);
+        return (int)values.size() - 1;
+    }
+    int find(const string &v) const {
+        auto it = ids.find(v);
+        return it == ids.end() ? -1 : it->second;
+    }
+    const string &decode(int id) const { return values[id]; }
+    int size() const { return (int)values.size(); }
+    void clear() {
+        ids.clear();
+        values.clear();
+    }
+};
+
+// Min/max price and area of one block of rows, plus Bloom filters over its
+// owners and (upper-cased) locations. Like the bounds, the filters only
+// grow: a tombstoned row leaves them conservative until the next rebuild.
+struct Zone {
+    int minPrice = INT_MAX, maxPrice = INT_MIN;
+    int minArea = INT_MAX, maxArea = INT_MIN;
+    BloomFilter owners, locations;
+
+    explicit Zone(size_t rows)
+        : owners(rows, bloomConfig.fpRate, bloomConfig.zoneBytes),
+          locations(rows, bloomConfig.fpRate, bloomConfig.zoneBytes) {}
+
+    bool overlaps(const PropertyFilter &f) const {
+        return minPrice <= f.maxPrice && maxPrice >= f.minPrice && minArea <= f.maxArea && maxArea >= f.minArea &&
+               (f.location.empty() || locations.mayContain(f.location));
+    }
+};
+
+// Column-wise copy of the table: one contiguous array per field, strings
+// dictionary-encoded (type and location upper-cased). Row i here is row i
+// of the property vector. Every ZONE_ROWS rows form a block with a zone
+// map, so range scans can skip blocks that cannot match.
+struct ColumnStore {
+    static constexpr int ZONE_ROWS = 1024;
+    Dictionary types, locations, owners;
+    ColumnArray<int> typeId, locationId, ownerId, price, area;
+    ColumnArray<int> ppsf;                // pricePerSqft(price, area)
+    ColumnArray<float> logPrice, logArea; // similarity features
+    ColumnArray<char> live; // 0 for tombstoned rows
+    vector<Zone> zones;
+
+    void clear() {
+        types.clear();
+        locations.clear();
+        owners.clear();
+        typeId.clear();
+        locationId.clear();
+        ownerId.clear();
+        price.clear();
+        area.clear();
+        ppsf.clear();
+        logPrice.clear();
+        logArea.clear();
+        live.clear();
+        zones.clear();
+    }
+
+    void add(const Property &p) {
+        if (price.size() % ZONE_ROWS == 0) zones.emplace_back(ZONE_ROWS);
+        Zone &z = zones.back();
+        z.owners.add(p.owner);
+        z.locations.add(toUpperCase(p.location));
+        z.minPrice = min(z.minPrice, p.price);
+        z.maxPrice = max(z.maxPrice, p.price);
+        z.minArea = min(z.minArea, p.area);
+        z.maxArea = max(z.maxArea, p.area);
+        typeId.push_back(types.encode(toUpperCase(p.type)));
+        locationId.push_back(locations.encode(toUpperCase(p.location)));
+        ownerId.push_back(owners.encode(p.owner));
+        price.push_back(p.price);
+        area.push_back(p.area);
+        ppsf.push_back(pricePerSqft(p.price, p.area));
+        logPrice.push_back(log((float)max(p.price, 1)));
+        logArea.push_back(log((float)max(p.area, 1)));
+        live.push_back(!p.deleted);
+    }
+
+    int size() const { return (int)price.size(); }
+};
+
+enum GroupField { BY_TYPE = 1, BY_LOCATION = 2, BY_OWNER = 3 };
+
+struct GroupStats {
+    string key;
+    long long count = 0;
+    long long priceSum = 0;
+    long long areaSum = 0;
+    int minPrice = INT_MAX;
+    int maxPrice = INT_MIN;
+
+    double meanPrice() const { return count ? (double)priceSum / count : 0; }
+    // Aggregate price per sq.ft (total price / total area), 0 if no area.
+    double pricePerSqft() const { return areaSum ? (double)priceSum / areaSum : 0; }
+};
+
+// Group-by over the encoded columns in one pass: the group id column is
+// read sequentially and accumulators live in arrays indexed by group id.
+// `rows` restricts the pass to a result set; null means the whole table.
+vector<GroupStats> aggregate(const ColumnStore &cols, GroupField field, const vector<int> *rows = nullptr) {
+    const Dictionary &dict = field == BY_TYPE ? cols.types : field == BY_LOCATION ? cols.locations : cols.owners;
+    const ColumnArray<int> &group = field == BY_TYPE ? cols.typeId : field == BY_LOCATION ? cols.locationId : cols.ownerId;
+
+    int g = dict.size();
+    vector<long long> count(g, 0), priceSum(g, 0), areaSum(g, 0);
+    vector<int> minP(g, INT_MAX), maxP(g, INT_MIN);
+    auto accumulate = [&](int i) {
+        int k = group[i], pr = cols.price[i];
+        count[k]++;
+        priceSum[k] += pr;
+        areaSum[k] += cols.area[i];
+        minP[k] = min(minP[k], pr);
+        maxP[k] = max(maxP[k], pr);
+    };
+    if (rows) {
+        for (int i : *rows) accumulate(i);
+    } else {
+        for (int i = 0, n = cols.size(); i < n; i++)
+            if (cols.live[i]) accumulate(i);
+    }
+
+    vector<GroupStats> out;
+    for (int k = 0; k < g; k++) {
+        if (!count[k]) continue;
+        GroupStats s;
+        s.key = dict.decode(k);
+        s.count = count[k];
+        s.priceSum = priceSum[k];
+        s.areaSum = areaSum[k];
+        s.minPrice = minP[k];
+        s.maxPrice = maxP[k];
+        out.push_back(s);
+    }
+    sort(out.begin(), out.end(), [](const GroupStats &a, const GroupStats &b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    });
+    return out;
+}
+
+// ================= Scan Kernels =================
+// Filters over the columns are compiled rather than interpreted: each
+// combination of type/location equality and price/area ranges is its own
+// template instantiation, so the inner loop carries no "is this predicate
+// set?" tests. Predicates are combined with & instead of && and rows are
+// selected by always writing the index and advancing by the predicate
+// result, which keeps the loop free of data-dependent branches.
+
+// Filter values resolved against the column store (dictionary ids).
+struct ScanBounds {
+    int typeId = -1, locationId = -1;
+    int minPrice = INT_MIN, maxPrice = INT_MAX;
+    int minArea = INT_MIN, maxArea = INT_MAX;
+};
+
+// Field descriptors: the column a predicate reads and where its operands
+// come from in ScanBounds.
+struct TypeField {
+    static constexpr ColumnArray<int> ColumnStore::*column = &ColumnStore::typeId;
+    static int value(const ScanBounds &b) { return b.typeId; }
+};
+struct LocationField {
+    static constexpr ColumnArray<int> ColumnStore::*column = &ColumnStore::locationId;
+    static int value(const ScanBounds &b) { return b.locationId; }
+};
+struct PriceField {
+    static constexpr ColumnArray<int> ColumnStore::*column = &ColumnStore::price;
+    static int lo(const ScanBounds &b) { return b.minPrice; }
+    static int hi(const ScanBounds &b) { return b.maxPrice; }
+};
+struct AreaField {
+    static constexpr ColumnArray<int> ColumnStore::*column = &ColumnStore::area;
+    static int lo(const ScanBounds &b) { return b.minArea; }
+    static int hi(const ScanBounds &b) { return b.maxArea; }
+};
+
+struct AlwaysTrue {
+    AlwaysTrue(const ColumnStore &, const ScanBounds &) {}
+    bool operator()(int) const { return true; }
+};
+
+struct LiveRow {
+    const char *live;
+    LiveRow(const ColumnStore &c, const ScanBounds &) : live(c.live.data()) {}
+    bool operator()(int i) const { return live[i] != 0; }
+};
+
+template <class Field>
+struct Equals {
+    const int *col;
+    int value;
+    Equals(const ColumnStore &c, const ScanBounds &b) : col((c.*Field::column).data()), value(Field::value(b)) {}
+    bool operator()(int i) const { return col[i] == value; }
+};
+
+// lo <= v <= hi as one unsigned comparison.
+template <class Field>
+struct Between {
+    const int *col;
+    unsigned lo, span;
+    Between(const ColumnStore &c, const ScanBounds &b)
+        : col((c.*Field::column).data()), lo((unsigned)Field::lo(b)),
+          span(Field::hi(b) < Field::lo(b) ? 0u : (unsigned)Field::hi(b) - (unsigned)Field::lo(b)) {}
+    bool operator()(int i) const { return (unsigned)col[i] - lo <= span; }
+};
+
+template <class... Preds>
+struct AllOf {
+    tuple<Preds...> preds;
+    AllOf(const ColumnStore &c, const ScanBounds &b) : preds(Preds(c, b)...) {}
+    bool operator()(int i) const {
+        return apply([i](const Preds &...p) { return (p(i) & ...); }, preds);
+    }
+};
+
+template <bool On, class Pred>
+using Optional = typename conditional<On, Pred, AlwaysTrue>::type;
+
+// Bit 0 type, bit 1 location, bit 2 price range, bit 3 area range.
+enum { SCAN_TYPE = 1, SCAN_LOCATION = 2, SCAN_PRICE = 4, SCAN_AREA = 8 };
+
+template <int Mask>
+using KernelPredicate = AllOf<LiveRow, Optional<(Mask & SCAN_TYPE) != 0, Equals<TypeField>>,
+                              Optional<(Mask & SCAN_LOCATION) != 0, Equals<LocationField>>,
+                              Optional<(Mask & SCAN_PRICE) != 0, Between<PriceField>>,
+                              Optional<(Mask & SCAN_AREA) != 0, Between<AreaField>>>;
+
+// Writes matching row numbers in [from, to) to `out` (room for to - from)
+// and returns how many matched.
+template <int Mask>
+size_t scanKernel(const ColumnStore &c, const ScanBounds &b, int from, int to, int *out) {
+    const KernelPredicate<Mask> pred(c, b);
+    size_t n = 0;
+    for (int i = from; i < to; i++) {
+        out[n] = i;
+        n += pred(i);
+    }
+    return n;
+}
+
+typedef size_t (*ScanFn)(const ColumnStore &, const ScanBounds &, int, int, int *);
+
+template <size_t... Masks>
+constexpr array<ScanFn, sizeof...(Masks)> makeKernels(index_sequence<Masks...>) {
+    return {{&scanKernel<(int)Masks>...}};
+}
+
+const array<ScanFn, 16> SCAN_KERNELS = makeKernels(make_index_sequence<16>());
+
+// A filter resolved into a kernel and its operands. `empty` is set when a
+// type or location is not in the dictionary, i.e. nothing can match.
+struct CompiledScan {
+    ScanFn kernel = nullptr;
+    ScanBounds bounds;
+    bool empty = false;
+
+    CompiledScan(const ColumnStore &c, const PropertyFilter &f) {
+        int mask = 0;
+        if (!f.type.empty()) {
+            mask |= SCAN_TYPE;
+            bounds.typeId = c.types.find(f.type);
+            empty |= bounds.typeId < 0;
+        }
+        if (!f.location.empty()) {
+            mask |= SCAN_LOCATION;
+            bounds.locationId = c.locations.find(f.location);
+            empty |= bounds.locationId < 0;
+        }
+        if (f.minPrice != INT_MIN || f.maxPrice != INT_MAX) mask |= SCAN_PRICE;
+        if (f.minArea != INT_MIN || f.maxArea != INT_MAX) mask |= SCAN_AREA;
+        bounds.minPrice = f.minPrice;
+        bounds.maxPrice = f.maxPrice;
+        bounds.minArea = f.minArea;
+        bounds.maxArea = f.maxArea;
+        kernel = SCAN_KERNELS[mask];
+    }
+
+    void run(const ColumnStore &c, int from, int to, vector<int> &out) const {
+        if (empty || from >= to) return;
+        size_t base = out.size();
+        out.resize(base + (to - from));
+        out.resize(base + kernel(c, bounds, from, to, out.data() + base));
+    }
+};
+
+// The interpreted equivalent: one loop for every filter, deciding per row
+// which predicates apply. Kept for --bench-kernels.
+void interpretedScan(const ColumnStore &c, const ScanBounds &b, int mask, vector<int> &out) {
+    for (int i = 0; i < c.size(); i++) {
+        if (!c.live[i]) continue;
+        if ((mask & SCAN_TYPE) && c.typeId[i] != b.typeId) continue;
+        if ((mask & SCAN_LOCATION) && c.locationId[i] != b.locationId) continue;
+        if ((mask & SCAN_PRICE) && (c.price[i] < b.minPrice || c.price[i] > b.maxPrice)) continue;
+        if ((mask & SCAN_AREA) && (c.area[i] < b.minArea || c.area[i] > b.maxArea)) continue;
+        out.push_back(i);
+    }
+}
+
+// `--bench-kernels [ROWS]`: synthetic table, a few filter shapes, each run
+// through Property::matches, the interpreted column loop and the kernel.
+int runKernelBench(int rows) {
+    const char *TYPES[] = {"HOUSE", "FLAT", "PLOT", "VILLA"};
+    const char *LOCS[] = {"PUNE", "MUMBAI", "SANGLI", "NASHIK", "THANE", "SATARA", "KOLHAPUR", "SOLAPUR"};
+    mt19937 rng(42);
+    vector<Property> props(rows);
+    ColumnStore cols;
+    for (auto &p : props) {
+        p.type = TYPES[rng() % 4];
+        p.location = LOCS[rng() % 8];
+        p.price = 1000 + rng() % 9000000;
+        p.area = 100 + rng() % 5000;
+        p.owner = "owner" + to_string(rng() % 1000);
+        p.deleted = rng() % 20 == 0;
+        cols.add(p);
+    }
+
+    struct Case {
+        const char *name;
+        PropertyFilter f;
+    };
+    vector<Case> cases(4);
+    cases[0].name = "price range";
+    cases[0].f.minPrice = 2000000, cases[0].f.maxPrice = 4000000;
+    cases[1].name = "type + location";
+    cases[1].f.type = "FLAT", cases[1].f.location = "PUNE";
+    cases[2].name = "location + price";
+    cases[2].f.location = "SANGLI", cases[2].f.minPrice = 100000, cases[2].f.maxPrice = 5000000;
+    cases[3].name = "all four";
+    cases[3].f = cases[2].f, cases[3].f.type = "HOUSE", cases[3].f.minArea = 500, cases[3].f.maxArea = 3000;
+
+    auto timeIt = [](const function<size_t()> &run, size_t &hits) {
+        auto start = chrono::steady_clock::now();
+        const int REPS = 5;
+        for (int r = 0; r < REPS; r++) hits = run();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / REPS;
+    };
+
+    cout << BOLD << "Scan kernels over " << rows << " rows (ms per query)\n" << RESET;
+    cout << left << setw(18) << "filter" << setw(12) << "matches()" << setw(14) << "interpreted" << setw(10)
+         << "kernel" << "speedup\n";
+    bool agree = true;
+    for (auto &c : cases) {
+        CompiledScan compiled(cols, c.f);
+        int mask = 0;
+        for (int m = 0; m < 16; m++)
+            if (SCAN_KERNELS[m] == compiled.kernel) mask = m;
+        size_t a = 0, b = 0, k = 0;
+        double tMatch = timeIt([&] {
+            size_t n = 0;
+            for (auto &p : props) n += c.f.matches(p);
+            return n;
+        }, a);
+        double tInterp = timeIt([&] {
+            vector<int> out;
+            interpretedScan(cols, compiled.bounds, mask, out);
+            return out.size();
+        }, b);
+        double tKernel = timeIt([&] {
+            vector<int> out;
+            compiled.run(cols, 0, cols.size(), out);
+            return out.size();
+        }, k);
+        agree &= a == b && b == k;
+        cout << left << setw(18) << c.name << setw(12) << fixed << setprecision(2) << tMatch << setw(14) << tInterp
+             << setw(10) << tKernel << setprecision(1) << tInterp / max(tKernel, 1e-6) << "x\n";
+    }
+    cout << (agree ? GREEN "All three paths returned the same rows.\n" : RED "Result counts differ!\n") << RESET;
+    return agree ? 0 : 1;
+}
+
+// `--bench-memory ROWS [THREADS]`: the table split into one column store
+// per thread, scanned in parallel (one pass over four columns) and probed
+// at random rows (one read from each of the same four columns).
+//  - default: 4 KiB pages, every partition loaded by the main thread,
+//    scan threads left to the scheduler;
+//  - placed: huge pages, each partition loaded and scanned by a thread
+//    pinned to node (partition % nodes).
+int runMemoryBench(int rows, int threads) {
+    const char *TYPES[] = {"HOUSE", "FLAT", "PLOT", "VILLA"};
+    const char *LOCS[] = {"PUNE", "MUMBAI", "SANGLI", "NASHIK", "THANE", "SATARA", "KOLHAPUR", "SOLAPUR"};
+    threads = max(1, threads);
+    rows = max(rows, threads);
+    const int NODES = (int)numaNodes().size();
+    const int SCAN_REPS = 10;
+    const size_t PROBES = 4000000;
+
+    auto fill = [&](ColumnStore &cols, int part) {
+        mt19937 rng(42 + part);
+        Property p;
+        for (int i = part; i < rows; i += threads) {
+            p.type = TYPES[rng() % 4];
+            p.location = LOCS[rng() % 8];
+            p.price = 1000 + rng() % 9000000;
+            p.area = 100 + rng() % 5000;
+            p.owner = "owner" + to_string(rng() % 1000);
+            cols.add(p);
+        }
+    };
+    auto scan = [](const ColumnStore &cols) {
+        long long sum = 0;
+        for (int i = 0; i < cols.size(); i++)
+            sum += cols.price[i] + cols.area[i] + cols.ppsf[i] + (long long)cols.logPrice[i];
+        return sum;
+    };
+    auto probe = [&](const ColumnStore &cols, int part) {
+        mt19937 rng(7 + part);
+        long long sum = 0;
+        size_t n = cols.size();
+        for (size_t k = 0; k < PROBES / threads; k++) {
+            size_t i = rng() % n;
+            sum += cols.price[i] + cols.area[i] + cols.ppsf[i] + (long long)cols.logPrice[i];
+        }
+        return sum;
+    };
+    // Runs fn(part) on one fresh thread per partition; returns seconds.
+    auto parallel = [&](bool pinned, const function<void(int)> &fn) {
+        auto start = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++)
+            pool.emplace_back([&, t] {
+                if (pinned) pinToNode(t % NODES);
+                fn(t);
+            });
+        for (auto &th : pool) th.join();
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+
+    struct Result {
+        double gbps, nsPerProbe, buildMs;
+        long long scanMisses, probeMisses, hugeKb;
+        long long checksum;
+    };
+    TlbMissCounter tlb;
+    auto measure = [&](bool placed) {
+        HugePageMode saved = memoryConfig.hugePages;
+        memoryConfig.hugePages = placed ? (saved == HUGEPAGES_OFF ? HUGEPAGES_THP : saved) : HUGEPAGES_OFF;
+        long long hugeBefore = anonHugePagesKb();
+        vector<unique_ptr<ColumnStore>> parts;
+        for (int t = 0; t < threads; t++) parts.emplace_back(new ColumnStore());
+        memoryConfig.hugePages = saved;
+
+        Result r{};
+        auto start = chrono::steady_clock::now();
+        if (placed) parallel(true, [&](int t) { fill(*parts[t], t); });
+        else
+            for (int t = 0; t < threads; t++) fill(*parts[t], t);
+        r.buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        r.hugeKb = anonHugePagesKb() - hugeBefore;
+
+        vector<long long> sums(threads);
+        tlb.start();
+        double secs = parallel(placed, [&](int t) {
+            for (int rep = 0; rep < SCAN_REPS; rep++) sums[t] += scan(*parts[t]);
+        });
+        r.scanMisses = tlb.stop();
+        r.gbps = (double)rows * 16 * SCAN_REPS / secs / 1e9;
+
+        tlb.start();
+        secs = parallel(placed, [&](int t) { sums[t] += probe(*parts[t], t); });
+        r.probeMisses = tlb.stop();
+        r.nsPerProbe = secs * 1e9 / PROBES; // wall time, all threads together
+        for (long long s : sums) r.checksum += s;
+        return r;
+    };
+
+    cout << BOLD << "Column placement over " << rows << " rows, " << threads << " thread(s), " << NODES
+         << " NUMA node(s)\n" << RESET;
+    Result base = measure(false), placed = measure(true);
+    auto misses = [](long long n) { return n < 0 ? string("n/a") : to_string(n); };
+    auto huge = [](long long kb) { return kb < 0 ? string("n/a") : to_string(kb / 1024) + " MiB"; };
+    cout << left << setw(10) << "" << setw(10) << "build ms" << setw(10) << "scan GB/s" << setw(16)
+         << "scan dTLB miss" << setw(11) << "probe ns" << setw(17) << "probe dTLB miss" << "huge pages\n";
+    for (auto *r : {&base, &placed})
+        cout << left << setw(10) << (r == &base ? "default" : "placed") << fixed << setprecision(0) << setw(10)
+             << r->buildMs << setprecision(2) << setw(10) << r->gbps << setw(16) << misses(r->scanMisses)
+             << setprecision(1) << setw(11) << r->nsPerProbe << setw(17) << misses(r->probeMisses) << huge(r->hugeKb)
+             << "\n";
+    if (!tlb.ok()) cout << YELLOW << "dTLB counters unavailable (perf events not permitted here).\n" << RESET;
+    bool agree = base.checksum == placed.checksum;
+    cout << (agree ? GREEN "Both layouts read the same values.\n" : RED "Checksums differ!\n") << RESET;
+    return agree ? 0 : 1;
+}
+
+// ================= Similar Listings =================
+// k-nearest-neighbour search by brute force over the column arrays: one
+// sequential pass, a handful of float operations per row and a bounded
+// max-heap of the best k. Numeric features are compared in log space, so
+// 10% apart counts the same at any price, and each is divided by its
+// standard deviation over the live rows. Categorical mismatches add a fixed
+// penalty; positions add (km apart / GEO_SCALE_KM)^2.
+struct SimilarityWeights {
+    double price = 1.0, area = 1.0, pricePerSqft = 1.0;
+    double distance = 1.0;
+    double type = 1.5, location = 0.75; // added on mismatch
+};
+
+const double GEO_SCALE_KM = 25.0;
+
+struct FeatureScales {
+    double price = 1, area = 1, pricePerSqft = 1; // standard deviations
+};
+
+FeatureScales featureScales(const ColumnStore &c) {
+    double n = 0, sp = 0, sp2 = 0, sa = 0, sa2 = 0, sq = 0, sq2 = 0;
+    for (int i = 0; i < c.size(); i++) {
+        if (!c.live[i]) continue;
+        double p = c.logPrice[i], a = c.logArea[i], q = p - a;
+        n++;
+        sp += p, sp2 += p * p;
+        sa += a, sa2 += a * a;
+        sq += q, sq2 += q * q;
+    }
+    auto dev = [&](double s, double s2) {
+        double var = n > 1 ? (s2 - s * s / n) / (n - 1) : 0;
+        return var > 1e-9 ? sqrt(var) : 1.0;
+    };
+    FeatureScales f;
+    f.price = dev(sp, sp2);
+    f.area = dev(sa, sa2);
+    f.pricePerSqft = dev(sq, sq2);
+    return f;
+}
+
+// The k live rows closest to `target` (excluding it), as (distance, row),
+// closest first.
+vector<pair<double, int>> similarListings(const ColumnStore &c, const GeoGrid &geo, int target, int k,
+                                          const SimilarityWeights &w = SimilarityWeights()) {
+    vector<pair<double, int>> out;
+    if (k <= 0 || target < 0 || target >= c.size()) return out;
+    FeatureScales s = featureScales(c);
+    const float p0 = c.logPrice[target], a0 = c.logArea[target];
+    const float wp = w.price / (s.price * s.price), wa = w.area / (s.area * s.area);
+    const float wq = w.pricePerSqft / (s.pricePerSqft * s.pricePerSqft);
+    const int type0 = c.typeId[target], loc0 = c.locationId[target];
+    double lat0, lon0;
+    const bool located0 = geo.position(target, lat0, lon0);
+    const double kmLon = 111.32 * cos(lat0 * PI / 180.0), geoScale2 = GEO_SCALE_KM * GEO_SCALE_KM;
+
+    priority_queue<pair<double, int>> best; // max-heap: worst of the best k on top
+    for (int i = 0, n = c.size(); i < n; i++) {
+        if (!c.live[i] || i == target) continue;
+        float dp = c.logPrice[i] - p0, da = c.logArea[i] - a0, dq = dp - da;
+        double d = wp * dp * dp + wa * da * da + wq * dq * dq + w.type * (c.typeId[i] != type0) +
+                   w.location * (c.locationId[i] != loc0);
+        if ((int)best.size() == k && d > best.top().first) continue; // the position only adds
+        double lat, lon;
+        if (located0 && geo.position(i, lat, lon)) {
+            double dy = (lat - lat0) * 111.0, dx = (lon - lon0) * kmLon; // equirectangular is fine at city scale
+            d += w.distance * (dx * dx + dy * dy) / geoScale2;
+        } else {
+            d += w.distance; // unknown position: as if GEO_SCALE_KM away
+        }
+        if ((int)best.size() < k) best.push({d, i});
+        else if (make_pair(d, i) < best.top()) {
+            best.pop();
+            best.push({d, i});
+        }
+    }
+    out.resize(best.size());
+    for (int i = (int)best.size() - 1; i >= 0; i--) {
+        out[i] = best.top();
+        best.pop();
+    }
+    return out;
+}
+
+// `--bench-similar ROWS`: synthetic table, top-10 neighbours of a few rows,
+// checked against scoring and sorting every row.
+int runSimilarBench(int rows) {
+    const char *TYPES[] = {"HOUSE", "FLAT", "PLOT", "VILLA"};
+    const char *LOCS[] = {"PUNE", "MUMBAI", "SANGLI", "NASHIK", "THANE", "SATARA", "KOLHAPUR", "SOLAPUR"};
+    mt19937 rng(7);
+    ColumnStore cols;
+    GeoGrid geo;
+    for (int i = 0; i < rows; i++) {
+        Property p;
+        p.type = TYPES[rng() % 4];
+        p.location = LOCS[rng() % 8];
+        p.area = 200 + rng() % 4000;
+        p.price = p.area * (2000 + rng() % 8000);
+        if (rng() % 2 && lookupCity(p.location, p.lat, p.lon)) {
+            p.hasCoords = true;
+            p.lat += (int)(rng() % 2001 - 1000) * 1e-4;
+            p.lon += (int)(rng() % 2001 - 1000) * 1e-4;
+        }
+        p.deleted = rng() % 20 == 0;
+        cols.add(p);
+        geo.add(i, p);
+    }
+
+    const int K = 10, QUERIES = 5;
+    bool agree = true;
+    double total = 0;
+    for (int q = 0; q < QUERIES; q++) {
+        int target = rng() % rows;
+        auto start = chrono::steady_clock::now();
+        auto top = similarListings(cols, geo, target, K);
+        total += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        // Reference: the heap with room for every row keeps all of them.
+        auto all = similarListings(cols, geo, target, rows);
+        all.resize(min(all.size(), top.size()));
+        agree &= all == top;
+    }
+    cout << BOLD << "Top-" << K << " similar listings over " << rows << " rows: " << fixed << setprecision(2)
+         << total / QUERIES << " ms per query\n" << RESET;
+    cout << (agree ? GREEN "Matches a full sort of every row.\n" : RED "Differs from a full sort!\n") << RESET;
+    return agree ? 0 : 1;
+}
+
+// ================= Packed Columns =================
+// Integer column compressed in blocks of BLOCK values with frame-of-
+// reference bit packing: a block stores its minimum and the bit width of
+// the largest (value - minimum), then those offsets packed into 64-bit
+// words. Prices and areas repeat a handful of round values, so most blocks
+// need far fewer than 32 bits per value. Plain shifts and masks, no SIMD
+// intrinsics; the fixed-width unpack loop is left to the auto-vectoriser.
+class PackedColumn {
+public:
+    static const int BLOCK = 128;
+
+private:
+    struct Block {
+        int base;
+        int width;       // bits per offset, 0..32
+        size_t firstWord; // into words
+    };
+    vector<Block> blocks;
+    vector<uint64_t> words;
+    size_t count = 0;
+
+    static uint32_t extract(const uint64_t *w, size_t bit, int width) {
+        if (width == 0) return 0;
+        size_t word = bit >> 6;
+        int shift = (int)(bit & 63);
+        uint64_t v = w[word] >> shift;
+        if (shift + width > 64) v |= w[word + 1] << (64 - shift);
+        return (uint32_t)(v & ((1ULL << width) - 1));
+    }
+
+    size_t blockSize(size_t b) const { return min((size_t)BLOCK, count - b * BLOCK); }
+
+public:
+    static PackedColumn pack(const vector<int> &values) {
+        PackedColumn col;
+        col.count = values.size();
+        for (size_t start = 0; start < values.size(); start += BLOCK) {
+            size_t n = min((size_t)BLOCK, values.size() - start);
+            int lo = INT_MAX, hi = INT_MIN;
+            for (size_t i = 0; i < n; i++) {
+                lo = min(lo, values[start + i]);
+                hi = max(hi, values[start + i]);
+            }
+            uint32_t span = (uint32_t)((int64_t)hi - lo);
+            int width = 0;
+            while (width < 32 && (span >> width) != 0) width++;
+
+            Block b{lo, width, col.words.size()};
+            col.words.resize(b.firstWord + (n * width + 63) / 64 + 1, 0); // +1: reads may touch the next word
+            for (size_t i = 0; i < n && width; i++) {
+                uint64_t off = (uint32_t)((int64_t)values[start + i] - lo);
+                size_t bit = i * width, word = b.firstWord + (bit >> 6);
+                int shift = (int)(bit & 63);
+                col.words[word] |= off << shift;
+                if (shift + width > 64) col.words[word + 1] |= off >> (64 - shift);
+            }
+            col.blocks.push_back(b);
+        }
+        return col;
+    }
+
+    size_t size() const { return count; }
+
+    int get(size_t i) const {
+        const Block &b = blocks[i / BLOCK];
+        return (int)((int64_t)b.base + extract(words.data() + b.firstWord, (i % BLOCK) * b.width, b.width));
+    }
+
+    vector<int> unpack() const {
+        vector<int> out(count);
+        for (size_t b = 0; b < blocks.size(); b++) {
+            const Block &blk = blocks[b];
+            const uint64_t *w = words.data() + blk.firstWord;
+            for (size_t i = 0, n = blockSize(b); i < n; i++)
+                out[b * BLOCK + i] = (int)((int64_t)blk.base + extract(w, i * blk.width, blk.width));
+        }
+        return out;
+    }
+
+    // Positions whose value lies in [lo, hi]. Each block's bounds are
+    // translated into its offset space once, so values are compared while
+    // still packed; blocks whose frame cannot overlap are skipped.
+    void rangeScan(int lo, int hi, vector<int> &out) const {
+        if (lo > hi) return; // the unsigned compare below needs from <= to
+        for (size_t b = 0; b < blocks.size(); b++) {
+            const Block &blk = blocks[b];
+            int64_t top = (int64_t)blk.base + (blk.width ? (int64_t)((1ULL << blk.width) - 1) : 0);
+            if (hi < blk.base || lo > top) continue;
+            uint32_t from = lo > blk.base ? (uint32_t)((int64_t)lo - blk.base) : 0;
+            uint32_t to = (uint32_t)(min((int64_t)hi, top) - blk.base);
+            const uint64_t *w = words.data() + blk.firstWord;
+            for (size_t i = 0, n = blockSize(b); i < n; i++) {
+                uint32_t off = extract(w, i * blk.width, blk.width);
+                if (off - from <= to - from) out.push_back((int)(b * BLOCK + i));
+            }
+        }
+    }
+
+    void write(string &out) const {
+        putU32(out, (uint32_t)count);
+        for (auto &b : blocks) {
+            putU32(out, (uint32_t)b.base);
+            out += (char)b.width;
+        }
+        putU32(out, (uint32_t)words.size());
+        for (uint64_t w : words) {
+            putU32(out, (uint32_t)w);
+            putU32(out, (uint32_t)(w >> 32));
+        }
+    }
+
+    bool read(const char *&p, const char *end) {
+        if (end - p < 4) return false;
+        count = getU32(p);
+        p += 4;
+        size_t nBlocks = (count + BLOCK - 1) / BLOCK;
+        if ((size_t)(end - p) < nBlocks * 5 + 4) return false;
+        blocks.clear();
+        size_t wordPos = 0;
+        for (size_t b = 0; b < nBlocks; b++, p += 5) {
+            Block blk{(int)getU32(p), (int)(unsigned char)p[4], wordPos};
+            if (blk.width > 32) return false;
+            wordPos += (min((size_t)BLOCK, count - b * BLOCK) * blk.width + 63) / 64 + 1;
+            blocks.push_back(blk);
+        }
+        size_t nWords = getU32(p);
+        p += 4;
+        if (nWords != wordPos || (size_t)(end - p) < nWords * 8) return false;
+        words.resize(nWords);
+        for (size_t i = 0; i < nWords; i++, p += 8)
+            words[i] = getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+        return true;
+    }
+};
+
+// Compact archive of listings: the three string fields dictionary-encoded
+// and every integer column (dictionary ids, price, area, id) packed as
+// above. Coordinates are kept as packed micro-degrees for the rows that
+// have them. Descriptions stay in descriptions.csv, keyed by id.
+struct ListingArchive {
+    vector<string> types, locations, owners;
+    PackedColumn typeId, locationId, ownerId, price, area, id, hasCoords, lat, lon;
+    PackedColumn ppsf; // derived from price and area, stored for --archive-scan
+
+    static void putString(string &out, const string &s) {
+        putU32(out, (uint32_t)s.size());
+        out += s;
+    }
+
+    static bool getString(const char *&p, const char *end, string &s) {
+        if (end - p < 4) return false;
+        uint32_t n = getU32(p);
+        p += 4;
+        if ((size_t)(end - p) < n) return false;
+        s.assign(p, n);
+        p += n;
+        return true;
+    }
+
+    static ListingArchive build(const vector<Property> &rows) {
+        Dictionary t, l, o;
+        vector<int> tid, lid, oid, pr, ar, ids, coords, la, lo, value;
+        for (auto &p : rows) {
+            tid.push_back(t.encode(p.type));
+            lid.push_back(l.encode(p.location));
+            oid.push_back(o.encode(p.owner));
+            pr.push_back(p.price);
+            ar.push_back(p.area);
+            value.push_back(pricePerSqft(p.price, p.area));
+            ids.push_back(p.id);
+            coords.push_back(p.hasCoords);
+            if (p.hasCoords) {
+                la.push_back((int)lround(p.lat * 1e6));
+                lo.push_back((int)lround(p.lon * 1e6));
+            }
+        }
+        ListingArchive a;
+        for (int i = 0; i < t.size(); i++) a.types.push_back(t.decode(i));
+        for (int i = 0; i < l.size(); i++) a.locations.push_back(l.decode(i));
+        for (int i = 0; i < o.size(); i++) a.owners.push_back(o.decode(i));
+        a.typeId = PackedColumn::pack(tid);
+        a.locationId = PackedColumn::pack(lid);
+        a.ownerId = PackedColumn::pack(oid);
+        a.price = PackedColumn::pack(pr);
+        a.area = PackedColumn::pack(ar);
+        a.id = PackedColumn::pack(ids);
+        a.hasCoords = PackedColumn::pack(coords);
+        a.lat = PackedColumn::pack(la);
+        a.lon = PackedColumn::pack(lo);
+        a.ppsf = PackedColumn::pack(value);
+        return a;
+    }
+
+    size_t size() const { return price.size(); }
+
+    vector<Property> rows() const {
+        vector<int> t = typeId.unpack(), l = locationId.unpack(), o = ownerId.unpack();
+        vector<int> pr = price.unpack(), ar = area.unpack(), ids = id.unpack(), c = hasCoords.unpack();
+        vector<int> la = lat.unpack(), lo = lon.unpack();
+        vector<Property> out(size());
+        for (size_t i = 0, k = 0; i < out.size(); i++) {
+            Property &p = out[i];
+            p.type = types[t[i]];
+            p.location = locations[l[i]];
+            p.owner = owners[o[i]];
+            p.price = pr[i];
+            p.area = ar[i];
+            p.id = ids[i];
+            if (c[i]) {
+                p.hasCoords = true;
+                p.lat = la[k] / 1e6;
+                p.lon = lo[k] / 1e6;
+                k++;
+            }
+        }
+        return out;
+    }
+
+    string serialize() const {
+        string out = "REA1";
+        for (auto *dict : {&types, &locations, &owners}) {
+            putU32(out, (uint32_t)dict->size());
+            for (auto &s : *dict) putString(out, s);
+        }
+        for (auto *col : {&typeId, &locationId, &ownerId, &price, &area, &id, &hasCoords, &lat, &lon, &ppsf})
+            col->write(out);
+        return out;
+    }
+
+    // Checks everything rows() and the scans index by, so a corrupt or
+    // truncated file is rejected here instead of read out of bounds.
+    // `error` says what was wrong.
+    bool parse(const string &bytes, string &error) {
+        const char *p = bytes.data(), *end = p + bytes.size();
+        if (bytes.compare(0, 4, "REA1") != 0) {
+            error = "not a listing archive";
+            return false;
+        }
+        p += 4;
+        for (auto *dict : {&types, &locations, &owners}) {
+            if (end - p < 4) {
+                error = "truncated dictionary";
+                return false;
+            }
+            uint32_t n = getU32(p);
+            p += 4;
+            if (n > (size_t)(end - p) / 4) { // every entry takes at least its length
+                error = "dictionary size " + to_string(n) + " exceeds the file";
+                return false;
+            }
+            dict->assign(n, "");
+            for (auto &s : *dict)
+                if (!getString(p, end, s)) {
+                    error = "truncated dictionary";
+                    return false;
+                }
+        }
+        for (auto *col : {&typeId, &locationId, &ownerId, &price, &area, &id, &hasCoords, &lat, &lon, &ppsf})
+            if (!col->read(p, end)) {
+                error = "truncated or malformed column";
+                return false;
+            }
+
+        size_t rows = size();
+        for (auto *col : {&typeId, &locationId, &ownerId, &area, &id, &hasCoords, &ppsf})
+            if (col->size() != rows) {
+                error = "column lengths differ from the row count";
+                return false;
+            }
+        if (!indexes(typeId, types.size()) || !indexes(locationId, locations.size()) || !indexes(ownerId, owners.size())) {
+            error = "dictionary id out of range";
+            return false;
+        }
+        vector<int> c = hasCoords.unpack();
+        size_t withCoords = 0;
+        for (int v : c) {
+            if (v != 0 && v != 1) {
+                error = "coordinate flag out of range";
+                return false;
+            }
+            withCoords += v;
+        }
+        if (lat.size() != withCoords || lon.size() != withCoords) {
+            error = "coordinate columns do not match the rows that have coordinates";
+            return false;
+        }
+        return true;
+    }
+
+    // True if every value of `col` is a valid index into `n` entries.
+    static bool indexes(const PackedColumn &col, size_t n) {
+        if (n == 0) return col.size() == 0;
+        vector<int> outside;
+        col.rangeScan(INT_MIN, -1, outside);
+        col.rangeScan((int)n, INT_MAX, outside);
+        return outside.empty();
+    }
+};
+
+// `--archive CSV OUT`: packs a listings CSV and reports the size saving.
+int runArchive(const string &csvPath, const string &outPath) {
+    vector<Property> rows;
+    ImportReport report = streamProperties(csvPath, [&](CsvRow &row) { rows.push_back(std::move(row.p)); });
+    string bytes = ListingArchive::build(rows).serialize();
+
+    // Round-trip check before anything is written.
+    ListingArchive check;
+    vector<Property> back;
+    string error;
+    if (check.parse(bytes, error)) back = check.rows();
+    for (size_t i = 0; i < rows.size() && back.size() == rows.size(); i++)
+        if (back[i].type != rows[i].type || back[i].location != rows[i].location || back[i].owner != rows[i].owner ||
+            back[i].price != rows[i].price || back[i].area != rows[i].area || back[i].id != rows[i].id ||
+            back[i].hasCoords != rows[i].hasCoords || fabs(back[i].lat - rows[i].lat) > 1e-6 ||
+            fabs(back[i].lon - rows[i].lon) > 1e-6)
+            back.clear();
+    if (back.size() != rows.size()) {
+        cout << RED << "Archive round-trip check failed; nothing written.\n" << RESET;
+        return 1;
+    }
+
+    ofstream fout(outPath, ios::binary);
+    fout.write(bytes.data(), bytes.size());
+    if (!fout) {
+        cout << RED << "Cannot write " << outPath << "\n" << RESET;
+        return 1;
+    }
+    size_t csvBytes = readFile(csvPath, true).size();
+    cout << GREEN << "Archived " << rows.size() << " listings (" << report.rejected << " rejected): "
+         << csvBytes << " bytes of CSV -> " << bytes.size() << " bytes ("
+         << fixed << setprecision(1) << (bytes.empty() ? 0.0 : (double)csvBytes / bytes.size()) << "x)\n" << RESET;
+    return 0;
+}
+
+// `--archive-scan FILE price|area|ppsf MIN MAX`: range scan straight on
+// the packed column; only matching rows are decoded. ppsf bounds are whole
+// rupees per sq.ft.
+int runArchiveScan(const string &path, const string &field, int lo, int hi) {
+    ListingArchive a;
+    string error;
+    if (!a.parse(readFile(path, true), error)) {
+        cout << RED << "Cannot read " << path << ": " << error << "\n" << RESET;
+        return 1;
+    }
+    if (field != "price" && field != "area" && field != "ppsf") {
+        cout << RED << "Unknown field '" << field << "'; use price, area or ppsf\n" << RESET;
+        return 1;
+    }
+    if (lo > hi) {
+        cout << RED << "MIN " << lo << " is above MAX " << hi << "\n" << RESET;
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    vector<int> hits;
+    if (field == "ppsf") {
+        int64_t from = (int64_t)max(lo, 0) * PPSF_SCALE, to = (int64_t)hi * PPSF_SCALE + PPSF_SCALE - 1;
+        if (from <= INT_MAX) a.ppsf.rangeScan((int)from, (int)min(to, (int64_t)INT_MAX), hits);
+    } else {
+        (field == "area" ? a.area : a.price).rangeScan(lo, hi, hits);
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << GREEN << hits.size() << " of " << a.size() << " listings with " << field << " in [" << lo << ", " << hi
+         << "] (" << fixed << setprecision(3) << ms << " ms)\n" << RESET;
+    for (size_t k = 0; k < hits.size() && k < 20; k++) {
+        int i = hits[k];
+        cout << a.id.get(i) << ": " << a.types[a.typeId.get(i)] << ", " << a.locations[a.locationId.get(i)]
+             << ", " << a.price.get(i) << ", " << a.area.get(i) << ", " << a.owners[a.ownerId.get(i)] << ", "
+             << formatPpsf(a.ppsf.get(i)) << "/sq.ft\n";
+    }
+    return 0;
+}
+
+// ================= Materialized Statistics =================
+struct Aggregate {
+    long long count = 0;
+    long long priceSum = 0;
+    long long areaSum = 0;
+    int minPrice = INT_MAX;
+    int maxPrice = INT_MIN;
+
+    void add(int price, int area) {
+        count++;
+        priceSum += price;
+        areaSum += area;
+        minPrice = min(minPrice, price);
+        maxPrice = max(maxPrice, price);
+    }
+
+    // Counts and sums stay exact; min/max cannot be narrowed without a
+    // rescan, so they are flagged until the next rebuild.
+    void remove(int price, int area) {
+        count--;
+        priceSum -= price;
+        areaSum -= area;
+        if (price == minPrice || price == maxPrice) boundsStale = true;
+    }
+
+    bool boundsStale = false;
+};
+
+// Running aggregates per (location, type) cell plus the per-location,
+// per-type and overall margins, each updated in O(1) per insert so a
+// dashboard lookup never touches the table. Ids come from ColumnStore.
+class MaterializedStats {
+private:
+    unordered_map<long long, Aggregate> cells;
+    vector<Aggregate> byLocation, byType;
+    Aggregate total;
+
+    static long long cellKey(int locationId, int typeId) {
+        return ((long long)locationId << 32) | (unsigned int)typeId;
+    }
+
+public:
+    void clear() {
+        cells.clear();
+        byLocation.clear();
+        byType.clear();
+        total = Aggregate();
+    }
+
+    void add(int locationId, int typeId, int price, int area) {
+        if (locationId >= (int)byLocation.size()) byLocation.resize(locationId + 1);
+        if (typeId >= (int)byType.size()) byType.resize(typeId + 1);
+        cells[cellKey(locationId, typeId)].add(price, area);
+        byLocation[locationId].add(price, area);
+        byType[typeId].add(price, area);
+        total.add(price, area);
+    }
+
+    void remove(int locationId, int typeId, int price, int area) {
+        cells[cellKey(locationId, typeId)].remove(price, area);
+        byLocation[locationId].remove(price, area);
+        byType[typeId].remove(price, area);
+        total.remove(price, area);
+    }
+
+    // -1 means "any" for either id; returns null for an empty cell.
+    const Aggregate *get(int locationId, int typeId) const {
+        const Aggregate *a = nullptr;
+        if (locationId < 0 && typeId < 0) {
+            a = &total;
+        } else if (typeId < 0) {
+            if (locationId < (int)byLocation.size()) a = &byLocation[locationId];
+        } else if (locationId < 0) {
+            if (typeId < (int)byType.size()) a = &byType[typeId];
+        } else {
+            auto it = cells.find(cellKey(locationId, typeId));
+            if (it != cells.end()) a = &it->second;
+        }
+        return a && a->count ? a : nullptr;
+    }
+};
+
+// ================= Query Cache =================
+// LRU cache of search results as row-number lists, bounded by an
+// approximate byte budget. An insert only drops the entries whose filter
+// the new row matches; everything else stays valid.
+class QueryCache {
+private:
+    struct Entry {
+        string key;
+        PropertyFilter filter;
+        vector<int> rows;
+        size_t bytes() const { return sizeof(Entry) + key.size() + rows.size() * sizeof(int); }
+    };
+    list<Entry> lru; // most recent first
+    unordered_map<string, list<Entry>::iterator> byKey;
+    size_t capacity;
+    size_t used = 0;
+
+    void erase(list<Entry>::iterator it) {
+        used -= it->bytes();
+        byKey.erase(it->key);
+        lru.erase(it);
+    }
+
+public:
+    size_t hits = 0, misses = 0;
+
+    explicit QueryCache(size_t capacityBytes) : capacity(capacityBytes) {}
+
+    void setCapacity(size_t bytes) {
+        capacity = bytes;
+        while (used > capacity && !lru.empty()) erase(prev(lru.end()));
+    }
+
+    bool contains(const string &key) const { return byKey.count(key) > 0; }
+
+    const vector<int> *get(const string &key) {
+        auto it = byKey.find(key);
+        if (it == byKey.end()) {
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        lru.splice(lru.begin(), lru, it->second);
+        return &it->second->rows;
+    }
+
+    void put(const PropertyFilter &filter, const vector<int> &rows) {
+        Entry e{filter.key(), filter, rows};
+        if (e.bytes() > capacity) return;
+        auto old = byKey.find(e.key);
+        if (old != byKey.end()) erase(old->second);
+        while (used + e.bytes() > capacity) erase(prev(lru.end()));
+        used += e.bytes();
+        lru.push_front(std::move(e));
+        byKey[lru.front().key] = lru.begin();
+    }
+
+    void invalidate(const Property &inserted) {
+        for (auto it = lru.begin(); it != lru.end();) {
+            auto next = std::next(it);
+            if (it->filter.matches(inserted)) erase(it);
+            it = next;
+        }
+    }
+
+    void clear() {
+        lru.clear();
+        byKey.clear();
+        used = 0;
+    }
+};
+
+// ================= Name Trie =================
+// Trie over the distinct (upper-cased) values of one text column. Each
+// terminal node owns the rows carrying that value, so prefix completion
+// and edit-distance search only walk the trie, never the table.
+class NameTrie {
+private:
+    struct Node {
+        vector<pair<char, int>> children; // sorted by char
+        int nameId = -1;
+    };
+    vector<Node> nodes;
+    vector<string> names;
+    vector<vector<int>> rows;
+    size_t filed = 0; // total of rows[]
+
+    int child(int node, char c) const {
+        for (auto &ch : nodes[node].children)
+            if (ch.first == c) return ch.second;
+        return -1;
+    }
+
+    void collect(int node, size_t limit, vector<int> &out) const {
+        if (out.size() >= limit) return;
+        if (nodes[node].nameId != -1) out.push_back(nodes[node].nameId);
+        for (auto &ch : nodes[node].children)
+            collect(ch.second, limit, out);
+    }
+
+    // Levenshtein DP carried down the trie: `prev` is the row for the path
+    // so far; branches whose best cell already exceeds maxDist are pruned.
+    void fuzzyWalk(int node, char c, const string &q, const vector<int> &prev,
+                   int maxDist, vector<pair<int, int>> &out) const {
+        vector<int> cur(q.size() + 1);
+        cur[0] = prev[0] + 1;
+        int best = cur[0];
+        for (size_t i = 1; i <= q.size(); i++) {
+            cur[i] = min({cur[i - 1] + 1, prev[i] + 1, prev[i - 1] + (q[i - 1] != c)});
+            best = min(best, cur[i]);
+        }
+        if (nodes[node].nameId != -1 && cur[q.size()] <= maxDist)
+            out.push_back({cur[q.size()], nodes[node].nameId});
+        if (best > maxDist) return;
+        for (auto &ch : nodes[node].children)
+            fuzzyWalk(ch.second, ch.first, q, cur, maxDist, out);
+    }
+
+public:
+    NameTrie() { clear(); }
+
+    void clear() {
+        nodes.assign(1, Node());
+        names.clear();
+        rows.clear();
+        filed = 0;
+    }
+
+    void add(const string &value, int row) {
+        string key = toUpperCase(value);
+        int node = 0;
+        for (char c : key) {
+            int next = child(node, c);
+            if (next == -1) {
+                next = nodes.size();
+                nodes.emplace_back();
+                auto &kids = nodes[node].children;
+                kids.insert(upper_bound(kids.begin(), kids.end(), make_pair(c, -1)), make_pair(c, next));
+            }
+            node = next;
+        }
+        if (nodes[node].nameId == -1) {
+            nodes[node].nameId = names.size();
+            names.push_back(key);
+            rows.emplace_back();
+        }
+        rows[nodes[node].nameId].push_back(row);
+        filed++;
+    }
+
+    const string &name(int id) const { return names[id]; }
+    const vector<int> &rowsOf(int id) const { return rows[id]; }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t rowCount() const { return filed; }
+
+    // Up to `limit` names starting with prefix, in alphabetical order.
+    vector<int> withPrefix(const string &prefix, size_t limit) const {
+        vector<int> out;
+        int node = 0;
+        for (char c : toUpperCase(prefix)) {
+            node = child(node, c);
+            if (node == -1) return out;
+        }
+        collect(node, limit, out);
+        return out;
+    }
+
+    // Names within maxDist edits of the query, closest first, as (distance, id).
+    vector<pair<int, int>> similar(const string &query, int maxDist) const {
+        string q = toUpperCase(query);
+        vector<int> first(q.size() + 1);
+        for (size_t i = 0; i <= q.size(); i++) first[i] = i;
+        vector<pair<int, int>> out;
+        for (auto &ch : nodes[0].children)
+            fuzzyWalk(ch.second, ch.first, q, first, maxDist, out);
+        sort(out.begin(), out.end());
+        return out;
+    }
+};
+
+// LEB128-style varints shared by the postings lists and price series.
+void putVarint(vector<uint8_t> &out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+uint32_t getVarint(const uint8_t *&p) {
+    uint32_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+// Zigzag keeps small negative numbers short as varints.
+inline uint32_t zigzag(int v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int unzigzag(uint32_t v) { return (int)(v >> 1) ^ -(int)(v & 1); }
+
+// ================= Text Index =================
+// Inverted index over listing descriptions. Each term's posting list is a
+// byte stream of (row delta, term frequency) varints; rows are appended in
+// increasing order so deltas stay small. Queries are ranked with BM25.
+class TextIndex {
+private:
+    struct Postings {
+        vector<uint8_t> bytes;
+        int lastRow = -1;
+        uint32_t docFreq = 0;
+    };
+    unordered_map<string, Postings> terms;
+    vector<uint32_t> docLen;
+    uint64_t totalLen = 0;
+
+public:
+    static vector<string> tokenize(const string &text) {
+        vector<string> out;
+        string cur;
+        for (char c : text) {
+            if (isalnum((unsigned char)c)) {
+                cur += (char)tolower((unsigned char)c);
+            } else if (!cur.empty()) {
+                out.push_back(cur);
+                cur.clear();
+            }
+        }
+        if (!cur.empty()) out.push_back(cur);
+        return out;
+    }
+
+    void clear() {
+        terms.clear();
+        docLen.clear();
+        totalLen = 0;
+    }
+
+    // Rows must be added in order, including rows with no text.
+    void add(int row, const string &text) {
+        vector<string> tokens = tokenize(text);
+        unordered_map<string, uint32_t> freq;
+        for (auto &t : tokens) freq[t]++;
+        for (auto &f : freq) {
+            Postings &post = terms[f.first];
+            putVarint(post.bytes, row - post.lastRow);
+            putVarint(post.bytes, f.second);
+            post.lastRow = row;
+            post.docFreq++;
+        }
+        docLen.push_back(tokens.size());
+        totalLen += tokens.size();
+    }
+
+    // Postings a search for the query would decode.
+    size_t postingsFor(const string &query) const {
+        vector<string> qTerms = tokenize(query);
+        sort(qTerms.begin(), qTerms.end());
+        qTerms.erase(unique(qTerms.begin(), qTerms.end()), qTerms.end());
+        size_t n = 0;
+        for (auto &t : qTerms) {
+            auto it = terms.find(t);
+            if (it != terms.end()) n += it->second.docFreq;
+        }
+        return n;
+    }
+
+    // Top k rows for the query as (score, row), best first. `accept`
+    // applies any structured filters before ranking.
+    vector<pair<double, int>> search(const string &query, size_t k,
+                                     const function<bool(int)> &accept) const {
+        const double K1 = 1.2, B = 0.75;
+        double n = docLen.size();
+        double avgLen = n > 0 ? max(1.0, totalLen / n) : 1.0;
+
+        vector<string> qTerms = tokenize(query);
+        sort(qTerms.begin(), qTerms.end());
+        qTerms.erase(unique(qTerms.begin(), qTerms.end()), qTerms.end());
+
+        unordered_map<int, double> scores;
+        for (auto &t : qTerms) {
+            auto it = terms.find(t);
+            if (it == terms.end()) continue;
+            const Postings &post = it->second;
+            double idf = log(1.0 + (n - post.docFreq + 0.5) / (post.docFreq + 0.5));
+            const uint8_t *p = post.bytes.data(), *end = p + post.bytes.size();
+            int row = -1;
+            while (p < end) {
+                row += getVarint(p);
+                double tf = getVarint(p);
+                scores[row] += idf * tf * (K1 + 1) / (tf + K1 * (1 - B + B * docLen[row] / avgLen));
+            }
+        }
+
+        vector<pair<double, int>> out;
+        for (auto &s : scores)
+            if (!accept || accept(s.first))
+                out.push_back({s.second, s.first});
+        size_t top = min(k, out.size());
+        partial_sort(out.begin(), out.begin() + top, out.end(), [](const pair<double, int> &a, const pair<double, int> &b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        out.resize(top);
+        return out;
+    }
+};
+
+// ================= Price History =================
+// Dates are whole days since 1970-01-01 (UTC); conversions after Howard
+// Hinnant's civil-calendar algorithms.
+int daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+string civilFromDays(int z) {
+    z += 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int d = doy - (153 * mp + 2) / 5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    int y = yoe + era * 400 + (m <= 2);
+    char tmp[32];
+    snprintf(tmp, sizeof(tmp), "%04d-%02d-%02d", y, m, d);
+    return tmp;
+}
+
+// YYYY-MM-DD.
+bool parseDate(const string &s, int &days) {
+    int y, m, d;
+    if (sscanf(s.c_str(), "%d-%d-%d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31) return false;
+    days = daysFromCivil(y, m, d);
+    return true;
+}
+
+int today() {
+    return (int)(chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count() / 86400);
+}
+
+// Append-only price series per listing id. A series is a byte string of
+// (day delta, zigzag price delta) varints; every CHECKPOINT_EVERY entries
+// the decoded (day, price) and the byte offset after it are kept, so an
+// as-of lookup binary-searches the checkpoints and decodes at most
+// CHECKPOINT_EVERY entries. Drops are also kept in a day-ordered event
+// list, so "dropped in the last N days" only reads that list's tail.
+class PriceHistory {
+public:
+    struct Point {
+        int day, price;
+    };
+    struct Drop {
+        int day, id;
+    };
+    static const uint32_t CHECKPOINT_EVERY = 16;
+
+private:
+    struct Checkpoint {
+        uint32_t offset; // just past this entry
+        int day, price;
+    };
+    struct Series {
+        vector<uint8_t> bytes;
+        vector<Checkpoint> checkpoints;
+        int lastDay = 0, lastPrice = 0;
+        uint32_t count = 0;
+    };
+    unordered_map<int, Series> series;
+    vector<Drop> drops;
+
+    // Days only run forward within one series, so a drop is normally the
+    // latest; one dated earlier (the clock went back between listings, or
+    // the history file interleaves them) is placed after its day's peers.
+    void addDrop(int day, int id) {
+        if (drops.empty() || drops.back().day <= day) {
+            drops.push_back({day, id});
+            return;
+        }
+        auto at = upper_bound(drops.begin(), drops.end(), day, [](int v, const Drop &d) { return v < d.day; });
+        drops.insert(at, {day, id});
+    }
+
+public:
+    // Records `price` for listing `id` from `day` on. Repeats of the last
+    // price are ignored, and a day before the last one is treated as the
+    // last one. Returns whether anything was recorded.
+    bool record(int id, int day, int price) {
+        Series &s = series[id];
+        if (s.count && price == s.lastPrice) return false;
+        day = s.count ? max(day, s.lastDay) : day;
+        putVarint(s.bytes, zigzag(s.count ? day - s.lastDay : day));
+        putVarint(s.bytes, zigzag(price - s.lastPrice));
+        if (s.count && price < s.lastPrice) addDrop(day, id);
+        if (s.count % CHECKPOINT_EVERY == 0) s.checkpoints.push_back({(uint32_t)s.bytes.size(), day, price});
+        s.lastDay = day;
+        s.lastPrice = price;
+        s.count++;
+        return true;
+    }
+
+    bool has(int id) const { return series.count(id) != 0; }
+
+    // Points recorded for the listing.
+    size_t length(int id) const {
+        auto it = series.find(id);
+        return it == series.end() ? 0 : it->second.count;
+    }
+
+    // Price in force at the end of `day`, or -1 if not yet listed then.
+    int priceAsOf(int id, int day) const {
+        auto it = series.find(id);
+        if (it == series.end()) return -1;
+        const Series &s = it->second;
+        auto cp = upper_bound(s.checkpoints.begin(), s.checkpoints.end(), day,
+                              [](int d, const Checkpoint &c) { return d < c.day; });
+        if (cp == s.checkpoints.begin()) return -1;
+        --cp;
+        int d = cp->day, price = cp->price;
+        const uint8_t *p = s.bytes.data() + cp->offset, *end = s.bytes.data() + s.bytes.size();
+        while (p < end) {
+            int nd = d + unzigzag(getVarint(p));
+            int np = price + unzigzag(getVarint(p));
+            if (nd > day) break;
+            d = nd;
+            price = np;
+        }
+        return price;
+    }
+
+    vector<Point> points(int id) const {
+        vector<Point> out;
+        auto it = series.find(id);
+        if (it == series.end()) return out;
+        const vector<uint8_t> &b = it->second.bytes;
+        int d = 0, price = 0;
+        for (const uint8_t *p = b.data(), *end = p + b.size(); p < end;) {
+            d += unzigzag(getVarint(p));
+            price += unzigzag(getVarint(p));
+            out.push_back({d, price});
+        }
+        return out;
+    }
+
+    // Drops recorded on or after `day`.
+    size_t dropCountSince(int day) const {
+        return drops.end() - lower_bound(drops.begin(), drops.end(), day, [](const Drop &d, int v) { return d.day < v; });
+    }
+
+    // Ids with at least one drop on or after `day`, each once.
+    vector<int> droppedSince(int day) const {
+        auto from = lower_bound(drops.begin(), drops.end(), day, [](const Drop &d, int v) { return d.day < v; });
+        vector<int> ids;
+        unordered_map<int, char> seen;
+        for (auto it = from; it != drops.end(); ++it)
+            if (seen.emplace(it->id, 1).second) ids.push_back(it->id);
+        return ids;
+    }
+};
+
+// ================= Saved Searches =================
+struct SavedSearch {
+    int id = 0;
+    string user;
+    string type, location; // upper-cased, empty = any
+    int minPrice = 0, maxPrice = INT_MAX;
+
+    string describe() const {
+        return "#" + to_string(id) + " (" + (type.empty() ? "ANY" : type) + ", " + (location.empty() ? "ANY" : location) +
+               ", " + to_string(minPrice) + "-" + (maxPrice == INT_MAX ? string("any") : to_string(maxPrice)) + ")";
+    }
+};
+
+// Stabbing queries over closed intervals. Entries are kept sorted by start
+// and read as an implicit balanced tree (the middle entry of a range is
+// its root), each node caching the largest end in its subtree, so a query
+// only descends where the point can still be covered: O(log n + matches).
+// Writes rebuild the cache in O(n), which suits saved searches (rare
+// writes, one query per new listing).
+class IntervalTree {
+private:
+    struct Entry {
+        int lo, hi, id;
+    };
+    vector<Entry> items;
+    vector<int> maxHi; // per node, indexed like items
+
+    int build(int l, int r) {
+        if (l > r) return INT_MIN;
+        int m = (l + r) / 2;
+        maxHi[m] = max({items[m].hi, build(l, m - 1), build(m + 1, r)});
+        return maxHi[m];
+    }
+
+    void stab(int l, int r, int x, vector<int> &out) const {
+        if (l > r) return;
+        int m = (l + r) / 2;
+        if (maxHi[m] < x) return; // nothing below here reaches x
+        stab(l, m - 1, x, out);
+        if (items[m].lo > x) return; // this start and every later one is past x
+        if (items[m].hi >= x) out.push_back(items[m].id);
+        stab(m + 1, r, x, out);
+    }
+
+public:
+    void insert(int lo, int hi, int id) {
+        Entry e{lo, hi, id};
+        items.insert(upper_bound(items.begin(), items.end(), e, [](const Entry &a, const Entry &b) { return a.lo < b.lo; }), e);
+        maxHi.resize(items.size());
+        build(0, (int)items.size() - 1);
+    }
+
+    void erase(int id) {
+        items.erase(remove_if(items.begin(), items.end(), [id](const Entry &e) { return e.id == id; }), items.end());
+        maxHi.resize(items.size());
+        build(0, (int)items.size() - 1);
+    }
+
+    bool empty() const { return items.empty(); }
+
+    void query(int x, vector<int> &out) const { stab(0, (int)items.size() - 1, x, out); }
+};
+
+// Saved searches bucketed by (type, location), either of which may be a
+// wildcard, with an interval tree over the price ranges in each bucket. A
+// listing probes its four buckets instead of testing every saved search.
+class SavedSearchIndex {
+private:
+    unordered_map<string, IntervalTree> buckets;
+
+    static string bucketOf(const string &type, const string &location) { return type + "|" + location; }
+
+public:
+    void add(const SavedSearch &s) { buckets[bucketOf(s.type, s.location)].insert(s.minPrice, s.maxPrice, s.id); }
+
+    void remove(const SavedSearch &s) {
+        auto it = buckets.find(bucketOf(s.type, s.location));
+        if (it == buckets.end()) return;
+        it->second.erase(s.id);
+        if (it->second.empty()) buckets.erase(it);
+    }
+
+    vector<int> match(const Property &p) const {
+        string t = toUpperCase(p.type), l = toUpperCase(p.location);
+        vector<int> ids;
+        for (const string &key : {bucketOf(t, l), bucketOf(t, ""), bucketOf("", l), bucketOf("", "")}) {
+            auto it = buckets.find(key);
+            if (it != buckets.end()) it->second.query(p.price, ids);
+        }
+        return ids;
+    }
+};
+
+// ================= Sharding =================
+// Listings can be partitioned by location across N shards. A shard is
+// either an in-process partition or a separate local process reached over
+// a Unix socket; the coordinator fans each query out to the shards in
+// parallel and merges the answers.
+int shardOf(const string &location, int shardCount) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : toUpperCase(location)) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return (int)(h % (uint64_t)shardCount);
+}
+
+bool cheaperFirst(const Property &a, const Property &b) {
+    return a.price != b.price ? a.price < b.price : a.id < b.id;
+}
+
+class ShardClient {
+public:
+    virtual ~ShardClient() {}
+    // Matches sorted by price (then id); false if the shard could not
+    // answer, leaving `out` with whatever arrived before it failed.
+    virtual bool query(const PropertyFilter &filter, vector<Property> &out) = 0;
+    virtual string name() const { return "in-process"; }
+    virtual void insert(const Property &p) = 0;
+    virtual void remove(int id) = 0;
+};
+
+// All work on a shard's rows runs on its own worker, so with --numa the
+// row array is allocated, filled and scanned from one node. The rows'
+// heap strings are copied on the worker too, but malloc may hand back
+// memory first touched elsewhere, so they are not guaranteed local.
+class LocalShard : public ShardClient {
+private:
+    ColumnArray<Property> rows;
+    unordered_map<int, size_t> slotOfId;
+    PinnedWorker worker; // last: joined before the rows go away
+
+public:
+    explicit LocalShard(int node = -1) : worker(memoryConfig.numa ? node : -1) {}
+
+    bool query(const PropertyFilter &filter, vector<Property> &out) override {
+        worker.call([this, &filter, &out] {
+            for (auto &p : rows)
+                if (filter.matches(p)) out.push_back(p);
+            sort(out.begin(), out.end(), cheaperFirst);
+        });
+        return true;
+    }
+
+    void insert(const Property &p) override {
+        worker.post([this, p] {
+            slotOfId[p.id] = rows.size();
+            rows.push_back(p);
+        });
+    }
+
+    // Order inside a shard does not matter, so the last row fills the gap.
+    void remove(int id) override {
+        worker.post([this, id] {
+            auto it = slotOfId.find(id);
+            if (it == slotOfId.end()) return;
+            size_t slot = it->second;
+            slotOfId.erase(it);
+            if (slot != rows.size() - 1) {
+                rows[slot] = std::move(rows.back());
+                slotOfId[rows[slot].id] = slot;
+            }
+            rows.pop_back();
+        });
+    }
+};
+
+#ifndef _WIN32
+// Newline-delimited request/response stream over a connected socket.
+class LineSocket {
+private:
+    int fd;
+    string pending;
+
+public:
+    explicit LineSocket(int f) : fd(f) {}
+    ~LineSocket() {
+        if (fd >= 0) close(fd);
+    }
+
+    bool ok() const { return fd >= 0; }
+
+    bool send(const string &data) {
+        for (size_t off = 0; off < data.size();) {
+            ssize_t n = write(fd, data.data() + off, data.size() - off);
+            if (n <= 0) return false;
+            off += n;
+        }
+        return true;
+    }
+
+    bool readLine(string &line) {
+        size_t nl;
+        while ((nl = pending.find('\n')) == string::npos) {
+            char buf[65536];
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) return false;
+            pending.append(buf, n);
+        }
+        line = pending.substr(0, nl);
+        pending.erase(0, nl + 1);
+        return true;
+    }
+};
+
+// Protocol, one request per line, tab-separated:
+//   Q <type> <location> <min> <max> <min area> <max area>
+//                                    -> matching CSV rows, then "."
+//   A <csv row>                      -> "OK"
+//   D <id>                           -> "OK"
+string encodeQuery(const PropertyFilter &f) {
+    return "Q\t" + f.type + "\t" + f.location + "\t" + to_string(f.minPrice) + "\t" + to_string(f.maxPrice) + "\t" +
+           to_string(f.minArea) + "\t" + to_string(f.maxArea) + "\n";
+}
+
+bool decodeRow(const string &text, Property &p) {
+    CsvRow row;
+    row.text = text;
+    if (!parsePropertyLine(row)) return false;
+    p = row.p;
+    return true;
+}
+
+class SocketShard : public ShardClient {
+private:
+    string path;
+    LineSocket conn;
+
+    static int connectTo(const string &path) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    void expectOk() {
+        string reply;
+        conn.readLine(reply);
+    }
+
+public:
+    explicit SocketShard(const string &socketPath) : path(socketPath), conn(connectTo(socketPath)) {}
+
+    bool ok() const { return conn.ok(); }
+
+    string name() const override { return path; }
+
+    // Only the "." terminator proves the shard sent all its matches.
+    bool query(const PropertyFilter &filter, vector<Property> &out) override {
+        if (!conn.send(encodeQuery(filter))) return false;
+        string line;
+        Property p;
+        while (conn.readLine(line)) {
+            if (line == ".") return true;
+            if (decodeRow(line, p)) out.push_back(p);
+        }
+        return false;
+    }
+
+    void insert(const Property &p) override {
+        string row;
+        CsvWriter::appendRow(row, p);
+        if (conn.send("A\t" + row)) expectOk();
+    }
+
+    void remove(int id) override {
+        if (conn.send("D\t" + to_string(id) + "\n")) expectOk();
+    }
+};
+
+// Serves one LocalShard on a Unix socket until killed. The coordinator
+// pushes the shard's rows after connecting, so the process starts empty.
+int runShardServer(const string &path) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    if (listener < 0 || ::bind(listener, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 4) != 0) {
+        cout << RED << "Cannot listen on " << path << "\n" << RESET;
+        return 1;
+    }
+    cout << GREEN << "Shard listening on " << path << "\n" << RESET;
+
+    while (true) {
+        LineSocket conn(accept(listener, nullptr, nullptr));
+        if (!conn.ok()) continue;
+        LocalShard shard; // each coordinator connection re-seeds the shard
+        string line;
+        while (conn.readLine(line)) {
+            if (line.size() < 2 || line[1] != '\t') break;
+            string arg = line.substr(2);
+            if (line[0] == 'Q') {
+                vector<string> f;
+                stringstream ss(arg);
+                for (string part; getline(ss, part, '\t');) f.push_back(part);
+                f.resize(6);
+                PropertyFilter filter;
+                filter.type = f[0];
+                filter.location = f[1];
+                parseInt(f[2], filter.minPrice);
+                parseInt(f[3], filter.maxPrice);
+                parseInt(f[4], filter.minArea);
+                parseInt(f[5], filter.maxArea);
+                vector<Property> matches;
+                shard.query(filter, matches);
+                string reply;
+                for (auto &p : matches) CsvWriter::appendRow(reply, p);
+                reply += ".\n";
+                if (!conn.send(reply)) break;
+            } else if (line[0] == 'A') {
+                Property p;
+                if (decodeRow(arg, p)) shard.insert(p);
+                if (!conn.send("OK\n")) break;
+            } else if (line[0] == 'D') {
+                shard.remove(atoi(arg.c_str()));
+                if (!conn.send("OK\n")) break;
+            }
+        }
+    }
+}
+#endif
+
+class ShardCoordinator {
+private:
+    vector<unique_ptr<ShardClient>> shards;
+
+public:
+    explicit ShardCoordinator(vector<unique_ptr<ShardClient>> s) : shards(std::move(s)) {}
+
+    int count() const { return (int)shards.size(); }
+
+    void insert(const Property &p) { shards[shardOf(p.location, count())]->insert(p); }
+    void remove(const Property &p) { shards[shardOf(p.location, count())]->remove(p.id); }
+
+    // Scatter-gather. A location filter pins the query to its one shard;
+    // otherwise every shard runs it concurrently and the per-shard sorted
+    // lists are k-way merged into one price-ordered list. Shards that did
+    // not answer in full are named in `failed`.
+    vector<Property> search(const PropertyFilter &filter, vector<string> &failed) {
+        if (!filter.location.empty()) {
+            ShardClient *client = shards[shardOf(filter.location, count())].get();
+            vector<Property> out;
+            if (!client->query(filter, out)) failed.push_back(client->name());
+            return out;
+        }
+
+        vector<vector<Property>> parts(shards.size());
+        vector<future<bool>> pending;
+        for (size_t i = 0; i < shards.size(); i++) {
+            ShardClient *client = shards[i].get();
+            vector<Property> *part = &parts[i];
+            pending.push_back(async(launch::async, [client, part, &filter] { return client->query(filter, *part); }));
+        }
+        for (size_t i = 0; i < pending.size(); i++)
+            if (!pending[i].get()) failed.push_back(shards[i]->name());
+
+        typedef pair<int, size_t> Cursor; // (part, position)
+        auto later = [&](const Cursor &a, const Cursor &b) {
+            return cheaperFirst(parts[b.first][b.second], parts[a.first][a.second]);
+        };
+        priority_queue<Cursor, vector<Cursor>, decltype(later)> heap(later);
+        for (int i = 0; i < (int)parts.size(); i++)
+            if (!parts[i].empty()) heap.push({i, 0});
+        vector<Property> out;
+        while (!heap.empty()) {
+            Cursor c = heap.top();
+            heap.pop();
+            out.push_back(parts[c.first][c.second]);
+            if (c.second + 1 < parts[c.first].size()) heap.push({c.first, c.second + 1});
+        }
+        return out;
+    }
+};
+
+// ================= Cold Storage =================
+// Buffer-pool mode for variable-length fields: they are appended to a
+// scratch page file and read back through an LRU cache of PAGE-byte pages
+// held under a byte budget. The file is rebuilt at every start, since the
+// CSV files stay the durable copy. Thread-safe; the compactor reads it
+// without the store lock.
+class PagedHeap {
+public:
+    static constexpr size_t PAGE = 4096;
+
+private:
+    fstream file;
+    uint64_t end = 0;
+    const size_t budget;
+    list<pair<uint64_t, string>> lru; // front = most recently used
+    unordered_map<uint64_t, list<pair<uint64_t, string>>::iterator> cached;
+    size_t hits = 0, misses = 0;
+    mutable mutex m;
+
+    const string &page(uint64_t no) {
+        auto it = cached.find(no);
+        if (it != cached.end()) {
+            hits++;
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+        misses++;
+        string data(PAGE, '\0');
+        file.clear();
+        file.seekg(no * PAGE);
+        file.read(&data[0], PAGE);
+        data.resize((size_t)file.gcount());
+        lru.emplace_front(no, std::move(data));
+        cached[no] = lru.begin();
+        while (lru.size() > 1 && lru.size() * PAGE > budget) {
+            cached.erase(lru.back().first);
+            lru.pop_back();
+        }
+        return lru.front().second;
+    }
+
+public:
+    PagedHeap(const string &path, size_t budgetBytes) : budget(max(budgetBytes, PAGE)) {
+        file.open(path, ios::in | ios::out | ios::binary | ios::trunc);
+    }
+
+    bool ok() const { return file.is_open(); }
+
+    // Returns the offset the bytes were stored at.
+    uint64_t append(const char *data, size_t size) {
+        lock_guard<mutex> lock(m);
+        uint64_t at = end;
+        file.clear();
+        file.seekp(at);
+        file.write(data, size);
+        file.flush();
+        end += size;
+        // The tail page may be cached from before this write.
+        for (uint64_t no = at / PAGE; no <= end / PAGE; no++) {
+            auto it = cached.find(no);
+            if (it == cached.end()) continue;
+            lru.erase(it->second);
+            cached.erase(it);
+        }
+        return at;
+    }
+
+    string read(uint64_t offset, size_t length) {
+        lock_guard<mutex> lock(m);
+        string out;
+        out.reserve(length);
+        while (out.size() < length) {
+            uint64_t pos = offset + out.size();
+            const string &p = page(pos / PAGE);
+            size_t from = pos % PAGE;
+            if (from >= p.size()) break; // short file; should not happen
+            out.append(p, from, min(p.size() - from, length - out.size()));
+        }
+        return out;
+    }
+
+    // For whole-table passes (snapshots, compaction, reindexing): reads
+    // straight from the file, so they neither evict the working set nor
+    // count as cache traffic.
+    string readDirect(uint64_t offset, size_t length) {
+        lock_guard<mutex> lock(m);
+        string out(length, '\0');
+        file.clear();
+        file.seekg(offset);
+        file.read(&out[0], length);
+        out.resize((size_t)file.gcount());
+        return out;
+    }
+
+    void report() const {
+        lock_guard<mutex> lock(m);
+        size_t total = hits + misses;
+        cout << CYAN << "Page file: " << end / 1024 << " KB, cache " << lru.size() * PAGE / 1024 << " KB of "
+             << budget / 1024 << " KB budget, " << hits << " hits / " << misses << " misses";
+        if (total) cout << " (" << fixed << setprecision(1) << 100.0 * hits / total << "% hit rate)";
+        cout << "\n" << RESET;
+        cout.unsetf(ios::fixed);
+    }
+};
+
+// ================= Admission Control =================
+// Limits for the search path. A query's cost is the number of rows (or
+// grid cells, trie nodes, postings) its plan will touch; it is charged 1 + rows / ROWS_PER_TOKEN tokens from the
+// caller's bucket, and plans over `expensiveRows` also need one of
+// `maxRunning` slots, waiting in a queue of at most `maxQueued` for up to
+// `maxWaitMs` before being shed.
+struct AdmissionConfig {
+    double rate = 20;     // tokens per second, per session
+    double burst = 100;   // bucket size
+    size_t expensiveRows = 32768;
+    int maxRunning = 2;
+    int maxQueued = 8;
+    int maxWaitMs = 2000;
+};
+
+AdmissionConfig admissionConfig;
+
+struct QueryCost {
+    static const size_t ROWS_PER_TOKEN = 4096;
+    size_t rows = 0;
+    const char *plan = "index lookup";
+
+    double tokens() const { return 1 + (double)rows / ROWS_PER_TOKEN; }
+    bool expensive() const { return rows > admissionConfig.expensiveRows; }
+};
+
+// Token bucket kept as one atomic "theoretical arrival time" (GCRA): the
+// instant the bucket would be full again. Taking tokens pushes it forward
+// with a compare-and-swap, so there is no lock and no refill timer.
+class TokenBucket {
+private:
+    atomic<int64_t> tat{0}; // steady-clock nanoseconds
+
+public:
+    // Takes `cost` tokens (capped at the burst) or, if there are not
+    // enough, takes none and sets `retryAfter` in seconds.
+    bool take(double cost, double rate, double burst, double &retryAfter) {
+        int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t step = (int64_t)(min(cost, burst) / rate * 1e9), window = (int64_t)(burst / rate * 1e9);
+        int64_t old = tat.load(memory_order_relaxed);
+        for (;;) {
+            int64_t next = max(old, now) + step;
+            if (next - now > window) {
+                retryAfter = (next - now - window) / 1e9;
+                return false;
+            }
+            if (tat.compare_exchange_weak(old, next, memory_order_relaxed)) return true;
+        }
+    }
+
+    // Gives back tokens taken for a query that then did not run.
+    void refund(double cost, double rate, double burst) {
+        tat.fetch_sub((int64_t)(min(cost, burst) / rate * 1e9), memory_order_relaxed);
+    }
+};
+
+class AdmissionControl {
+public:
+    enum Verdict { ADMITTED, RATE_LIMITED, OVERLOADED };
+
+    // Holds an expensive-query slot until destroyed.
+    class Ticket {
+    private:
+        AdmissionControl *owner = nullptr;
+        friend class AdmissionControl;
+
+    public:
+        Ticket() = default;
+        Ticket(const Ticket &) = delete;
+        Ticket &operator=(const Ticket &) = delete;
+        ~Ticket() {
+            if (owner) owner->release();
+        }
+    };
+
+private:
+    mutex m;
+    condition_variable freed;
+    int running = 0, queued = 0;
+    TokenBucket anonymous; // shared by callers without a session
+
+    void release() {
+        {
+            lock_guard<mutex> lock(m);
+            running--;
+        }
+        freed.notify_one();
+    }
+
+public:
+    atomic<size_t> admitted{0}, deferred{0}, limited{0}, shed{0};
+
+    TokenBucket &anonymousBucket() { return anonymous; }
+
+    Verdict admit(TokenBucket &bucket, const QueryCost &cost, Ticket &ticket, double &retryAfter) {
+        const AdmissionConfig &c = admissionConfig;
+        if (!bucket.take(cost.tokens(), c.rate, c.burst, retryAfter)) {
+            limited++;
+            return RATE_LIMITED;
+        }
+        if (!cost.expensive()) {
+            admitted++;
+            return ADMITTED;
+        }
+
+        unique_lock<mutex> lock(m);
+        if (running >= c.maxRunning) {
+            bool got = false;
+            if (queued < c.maxQueued) {
+                queued++;
+                deferred++;
+                got = freed.wait_for(lock, chrono::milliseconds(c.maxWaitMs), [&] { return running < c.maxRunning; });
+                queued--;
+            }
+            if (!got) {
+                bucket.refund(cost.tokens(), c.rate, c.burst); // shed queries are not charged
+                shed++;
+                return OVERLOADED;
+            }
+        }
+        running++;
+        ticket.owner = this;
+        admitted++;
+        return ADMITTED;
+    }
+
+    void report() const {
+        cout << CYAN << "Queries admitted: " << admitted << " (" << deferred << " deferred), rate-limited: " << limited
+             << ", shed under load: " << shed << "\n" << RESET;
+    }
+};
+
+// `--bench-admission ROWS`: one client issuing full scans back to back and
+// one issuing cheap lookups, both needing the same store lock. Reports the
+// cheap client's latency percentiles with and without admission control.
+int runAdmissionBench(int rows) {
+    ColumnStore cols;
+    mt19937 rng(3);
+    for (int i = 0; i < rows; i++) {
+        Property p;
+        p.type = i % 2 ? "FLAT" : "HOUSE";
+        p.location = "PUNE";
+        p.price = 1000 + rng() % 9000000;
+        p.area = 100 + rng() % 5000;
+        cols.add(p);
+    }
+    PropertyFilter scanAll;
+    scanAll.minArea = 1000; // no zone can be skipped
+    CompiledScan scan(cols, scanAll);
+    QueryCost full, cheap;
+    full.rows = cols.size();
+    full.plan = "full scan";
+
+    auto trial = [&](bool limit) {
+        mutex store;
+        atomic<bool> done{false};
+        AdmissionControl admission;
+        TokenBucket attacker, victim;
+        thread noisy([&] {
+            while (!done) {
+                AdmissionControl::Ticket ticket;
+                double retry;
+                if (limit && admission.admit(attacker, full, ticket, retry) != AdmissionControl::ADMITTED) {
+                    this_thread::sleep_for(chrono::milliseconds(1)); // a real client would back off longer
+                    continue;
+                }
+                lock_guard<mutex> lock(store);
+                vector<int> out;
+                scan.run(cols, 0, cols.size(), out);
+            }
+        });
+        vector<double> latency;
+        for (int i = 0; i < 2000; i++) {
+            auto start = chrono::steady_clock::now();
+            AdmissionControl::Ticket ticket;
+            double retry;
+            if (!limit || admission.admit(victim, cheap, ticket, retry) == AdmissionControl::ADMITTED) {
+                lock_guard<mutex> lock(store);
+                volatile int v = cols.price[rng() % cols.size()];
+                (void)v;
+            }
+            latency.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+        done = true;
+        noisy.join();
+        sort(latency.begin(), latency.end());
+        auto pct = [&](double q) { return latency[(size_t)(q * (latency.size() - 1))]; };
+        cout << left << setw(22) << (limit ? "with admission" : "without admission") << fixed << setprecision(3)
+             << "p50 " << pct(0.5) << " ms  p99 " << pct(0.99) << " ms\n";
+        return pct(0.99);
+    };
+
+    cout << BOLD << "Cheap lookups beside back-to-back full scans of " << rows << " rows\n" << RESET;
+    double before = trial(false), after = trial(true);
+    cout << (after < before ? GREEN "Admission control kept cheap lookups fast.\n" : YELLOW "No improvement measured.\n")
+         << RESET;
+    return 0;
+}
+
+// ================= Workload Recording =================
+// A trace of what clients did, at the level of the store API, for replay
+// with --replay. Passwords are never recorded: a replayed login just opens
+// a session. Operation arguments, by op:
+//   LOGIN   strs: user                   LOGOUT  -
+//   FILTER  ints: filter  strs: filter   EXACT   ints: price
+//   RADIUS  ints: lat*1e6, lon*1e6, metres, filter  strs: filter
+//   FUZZY   ints: field  strs: term      KEYWORD strs: query, filter  ints: filter
+//   DROPS   ints: days                   HISTORY ints: id, day (-1 = none)
+//   SIMILAR ints: id, k                  DELETE  ints: id  strs: owner
+//   ADD     property                     UPDATE  ints: id, property  strs: property
+//   VALUE   ints: lo, hi (price per sq.ft, fixed point), k, filter  strs: filter
+// where a filter is ints minPrice, maxPrice, minArea, maxArea and strs
+// type, location, and a property is ints price, area, hasCoords, lat*1e6,
+// lon*1e6 and strs type, location, owner, description.
+enum WorkloadOp : uint8_t {
+    OP_LOGIN = 1, OP_LOGOUT, OP_FILTER, OP_EXACT, OP_RADIUS, OP_FUZZY, OP_KEYWORD,
+    OP_DROPS, OP_HISTORY, OP_SIMILAR, OP_ADD, OP_UPDATE, OP_DELETE, OP_VALUE, OP_COUNT
+};
+
+const char *const WORKLOAD_OP_NAMES[OP_COUNT] = {"?",       "login",   "logout", "filter",  "exact",
+                                                 "radius",  "fuzzy",   "keyword", "drops",  "history",
+                                                 "similar", "add",     "update",  "delete", "value"};
+
+struct WorkloadEvent {
+    uint64_t atUs = 0;    // since recording started
+    uint8_t op = 0;
+    uint32_t session = 0; // trace-local session number; 0 = anonymous
+    vector<int> ints;
+    vector<string> strs;
+
+    WorkloadEvent() = default;
+    WorkloadEvent(WorkloadOp o, uint32_t s, vector<int> i = {}, vector<string> t = {})
+        : op(o), session(s), ints(std::move(i)), strs(std::move(t)) {}
+
+    static int micro(double deg) { return (int)lround(deg * 1e6); }
+
+    WorkloadEvent &withFilter(const PropertyFilter &f) {
+        ints.insert(ints.end(), {f.minPrice, f.maxPrice, f.minArea, f.maxArea});
+        strs.push_back(f.type);
+        strs.push_back(f.location);
+        return *this;
+    }
+
+    WorkloadEvent &withProperty(const Property &p) {
+        ints.insert(ints.end(), {p.price, p.area, p.hasCoords, micro(p.lat), micro(p.lon)});
+        strs.insert(strs.end(), {p.type, p.location, p.owner, p.description});
+        return *this;
+    }
+
+    // Readers for the layouts above, starting at ints[i] / strs[s].
+    PropertyFilter filter(size_t i, size_t s) const {
+        PropertyFilter f;
+        f.minPrice = ints[i], f.maxPrice = ints[i + 1], f.minArea = ints[i + 2], f.maxArea = ints[i + 3];
+        f.type = strs[s], f.location = strs[s + 1];
+        return f;
+    }
+
+    Property property(size_t i, size_t s) const {
+        Property p;
+        p.price = ints[i], p.area = ints[i + 1], p.hasCoords = ints[i + 2];
+        p.lat = ints[i + 3] / 1e6, p.lon = ints[i + 4] / 1e6;
+        p.type = strs[s], p.location = strs[s + 1], p.owner = strs[s + 2], p.description = strs[s + 3];
+        return p;
+    }
+
+    // Checks the argument counts before anything indexes into them.
+    bool wellFormed() const {
+        static const pair<size_t, size_t> SHAPE[OP_COUNT] = {
+            {0, 0}, {0, 1}, {0, 0}, {4, 2}, {1, 0}, {7, 2}, {1, 1}, {4, 3}, {1, 0}, {2, 0}, {2, 0}, {5, 4}, {6, 4}, {1, 1}, {7, 2}};
+        return op > 0 && op < OP_COUNT && ints.size() == SHAPE[op].first && strs.size() == SHAPE[op].second;
+    }
+};
+
+const char WORKLOAD_MAGIC[4] = {'R', 'W', 'L', '1'};
+
+// The files a store reads at startup. Recording copies them next to the
+// trace so replay starts from the state the trace started from.
+const char *const DATA_FILES[] = {"users.csv",         "properties.csv",    "descriptions.csv",
+                                  "properties.journal", "properties.manifest", "price_history.csv",
+                                  "saved_searches.csv", "notifications.csv"};
+
+filesystem::path workloadSnapshotDir(const string &trace) { return trace + ".data"; }
+
+// Replaces `to`'s data files with those in `from` (files absent there are
+// removed). False with `ec` set on failure.
+bool copyDataFiles(const filesystem::path &from, const filesystem::path &to, error_code &ec) {
+    filesystem::create_directories(to, ec);
+    if (ec) return false;
+    for (const char *f : DATA_FILES) {
+        filesystem::remove(to / f, ec);
+        if (!ec && filesystem::exists(from / f)) filesystem::copy_file(from / f, to / f, ec);
+        if (ec) return false;
+    }
+    return true;
+}
+
+// Record: varint body length | body, where body is
+//   u8 op | varint session | varint µs since the previous record |
+//   varint #ints | zigzag varints | varint #strs | (varint length, bytes)...
+void encodeWorkloadEvent(const WorkloadEvent &e, uint64_t deltaUs, vector<uint8_t> &out) {
+    vector<uint8_t> body;
+    body.push_back(e.op);
+    putVarint(body, e.session);
+    putVarint(body, (uint32_t)min<uint64_t>(deltaUs, UINT32_MAX));
+    putVarint(body, e.ints.size());
+    for (int v : e.ints) putVarint(body, zigzag(v));
+    putVarint(body, e.strs.size());
+    for (auto &s : e.strs) {
+        putVarint(body, s.size());
+        body.insert(body.end(), s.begin(), s.end());
+    }
+    putVarint(out, body.size());
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+// Appends to a trace file through a buffer; safe to call from any thread.
+class WorkloadRecorder {
+private:
+    mutex m;
+    ofstream out;
+    vector<uint8_t> buffer;
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    uint64_t lastUs = 0;
+    size_t events = 0;
+
+    void drain() {
+        out.write((const char *)buffer.data(), buffer.size());
+        out.flush();
+        buffer.clear();
+    }
+
+public:
+    explicit WorkloadRecorder(const string &path) : out(path, ios::binary | ios::trunc) {
+        out.write(WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC));
+    }
+    ~WorkloadRecorder() {
+        lock_guard<mutex> lock(m);
+        drain();
+    }
+
+    bool ok() const { return out.good(); }
+
+    void record(const WorkloadEvent &e) {
+        uint64_t now = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        lock_guard<mutex> lock(m);
+        now = max(now, lastUs);
+        encodeWorkloadEvent(e, now - lastUs, buffer);
+        lastUs = now;
+        events++;
+        if (buffer.size() >= 64 * 1024) drain();
+    }
+};
+
+// Reads a trace; a torn or malformed tail ends it.
+bool loadWorkload(const string &path, vector<WorkloadEvent> &events) {
+    string bytes = readFile(path, true);
+    if (bytes.size() < sizeof(WORKLOAD_MAGIC) || bytes.compare(0, 4, WORKLOAD_MAGIC, 4) != 0) return false;
+    const uint8_t *p = (const uint8_t *)bytes.data() + 4, *end = (const uint8_t *)bytes.data() + bytes.size();
+    // Bounds-checked varint read; getVarint trusts its input.
+    auto next = [](const uint8_t *&q, const uint8_t *stop, uint32_t &v) {
+        v = 0;
+        for (int shift = 0; q < stop && shift < 35; shift += 7) {
+            uint8_t b = *q++;
+            v |= (uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    };
+    uint64_t at = 0;
+    uint32_t len, v, n;
+    while (next(p, end, len) && len <= (size_t)(end - p)) {
+        const uint8_t *q = p, *bodyEnd = p + len;
+        p = bodyEnd;
+        WorkloadEvent e;
+        if (q == bodyEnd) break;
+        e.op = *q++;
+        bool ok = next(q, bodyEnd, e.session) && next(q, bodyEnd, v) && next(q, bodyEnd, n);
+        at += v;
+        e.atUs = at;
+        for (uint32_t i = 0; ok && i < n; i++) {
+            ok = next(q, bodyEnd, v);
+            e.ints.push_back(unzigzag(v));
+        }
+        ok = ok && next(q, bodyEnd, n);
+        for (uint32_t i = 0; ok && i < n; i++) {
+            ok = next(q, bodyEnd, v) && v <= (size_t)(bodyEnd - q);
+            if (ok) e.strs.emplace_back((const char *)q, v);
+            if (ok) q += v;
+        }
+        if (!ok || q != bodyEnd || !e.wellFormed()) break;
+        events.push_back(std::move(e));
+    }
+    return true;
+}
+
+// ================= Sessions =================
+// One logged-in client. The token is what the client presents; `user` is
+// fixed for the session's life. The cached "my properties" rows are only
+// read or written under the store lock and are valid while `myRowsGeneration`
+// equals the store's generation.
+struct Session {
+    string token, user;
+    uint32_t serial = 0;          // numbers the session in workload traces
+    atomic<uint32_t> deadline{0}; // tick at which it expires unless touched
+    TokenBucket limiter;          // search rate limit
+    vector<int> myRows;
+    unsigned long long myRowsGeneration = ULLONG_MAX;
+};
+
+// Sessions by token in STRIPES independently locked hash maps, so lookups
+// on different tokens rarely contend. Expiry uses a hashed timer wheel of
+// one-second ticks: a session sits in the slot of its deadline, touching
+// it only moves the deadline (an atomic store), and when the wheel reaches
+// the slot each entry is either expired or re-filed under its new deadline.
+// The wheel has its own lock and is only walked once per tick.
+class SessionManager {
+public:
+    static const int STRIPES = 64;
+    static const uint32_t WHEEL_SLOTS = 512;
+
+private:
+    struct Stripe {
+        mutex m;
+        unordered_map<string, shared_ptr<Session>> sessions;
+    };
+    array<Stripe, STRIPES> stripes;
+    array<vector<shared_ptr<Session>>, WHEEL_SLOTS> wheel;
+    mutex wheelMutex;
+    atomic<uint32_t> now{0}; // ticks since start
+    const uint32_t idleTicks;
+    atomic<size_t> count{0};
+    atomic<uint32_t> serials{0};
+
+    mutex tickMutex;
+    condition_variable tickSignal;
+    bool stopping = false;
+    thread ticker;
+
+    Stripe &stripeOf(const string &token) { return stripes[hash<string>()(token) % STRIPES]; }
+
+    void schedule(const shared_ptr<Session> &s) {
+        lock_guard<mutex> lock(wheelMutex);
+        wheel[s->deadline % WHEEL_SLOTS].push_back(s);
+    }
+
+    // 128 bits from the OS entropy source, as hex.
+    static string newToken() {
+        static thread_local random_device entropy;
+        char tmp[33];
+        snprintf(tmp, sizeof(tmp), "%08x%08x%08x%08x", entropy(), entropy(), entropy(), entropy());
+        return tmp;
+    }
+
+public:
+    // With autoTick off the owner drives the clock through advance().
+    explicit SessionManager(uint32_t idleSeconds = 30 * 60, bool autoTick = true) : idleTicks(max(idleSeconds, 1u)) {
+        if (!autoTick) return;
+        ticker = thread([this] {
+            unique_lock<mutex> lock(tickMutex);
+            while (!tickSignal.wait_for(lock, chrono::seconds(1), [this] { return stopping; })) {
+                lock.unlock();
+                advance();
+                lock.lock();
+            }
+        });
+    }
+
+    ~SessionManager() {
+        {
+            lock_guard<mutex> lock(tickMutex);
+            stopping = true;
+        }
+        tickSignal.notify_all();
+        if (ticker.joinable()) ticker.join();
+    }
+
+    string create(const string &user) {
+        auto s = make_shared<Session>();
+        s->user = user;
+        s->serial = ++serials;
+        s->deadline = now + idleTicks;
+        for (;;) {
+            s->token = newToken();
+            Stripe &st = stripeOf(s->token);
+            lock_guard<mutex> lock(st.m);
+            if (st.sessions.emplace(s->token, s).second) break;
+        }
+        count++;
+        schedule(s);
+        return s->token;
+    }
+
+    // The live session for a token, with its idle deadline pushed back;
+    // null if unknown or expired.
+    shared_ptr<Session> find(const string &token) {
+        Stripe &st = stripeOf(token);
+        shared_ptr<Session> s;
+        {
+            lock_guard<mutex> lock(st.m);
+            auto it = st.sessions.find(token);
+            if (it == st.sessions.end()) return nullptr;
+            s = it->second;
+        }
+        uint32_t t = now;
+        if (s->deadline <= t) return nullptr; // the wheel has not got to it yet
+        s->deadline = t + idleTicks;
+        return s;
+    }
+
+    void end(const string &token) {
+        Stripe &st = stripeOf(token);
+        lock_guard<mutex> lock(st.m);
+        auto it = st.sessions.find(token);
+        if (it == st.sessions.end()) return;
+        it->second->deadline = 0; // its wheel entry is dropped when reached
+        st.sessions.erase(it);
+        count--;
+    }
+
+    // Moves the clock one tick and expires the sessions filed under it.
+    void advance() {
+        uint32_t t = ++now;
+        vector<shared_ptr<Session>> due;
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            due.swap(wheel[t % WHEEL_SLOTS]);
+        }
+        for (auto &s : due) {
+            if (s->deadline == 0) continue; // logged out
+            if (s->deadline > t) {
+                schedule(s); // touched since it was filed
+                continue;
+            }
+            Stripe &st = stripeOf(s->token);
+            lock_guard<mutex> lock(st.m);
+            auto it = st.sessions.find(s->token);
+            if (it != st.sessions.end() && it->second == s) {
+                st.sessions.erase(it);
+                count--;
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+};
+
+// `--bench-sessions N`: N sessions created and looked up from 8 threads,
+// then expired by driving the wheel past the idle timeout.
+int runSessionBench(int n) {
+    const int THREADS = 8, IDLE = 60;
+    SessionManager sessions(IDLE, false);
+    vector<vector<string>> tokens(THREADS);
+    auto run = [&](const function<void(int)> &work) {
+        auto start = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (int t = 0; t < THREADS; t++) pool.emplace_back(work, t);
+        for (auto &th : pool) th.join();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+
+    double tCreate = run([&](int t) {
+        for (int i = t; i < n; i += THREADS) tokens[t].push_back(sessions.create("user" + to_string(i)));
+    });
+    atomic<long> misses{0};
+    const int LOOKUPS = 10;
+    double tFind = run([&](int t) {
+        for (int r = 0; r < LOOKUPS; r++)
+            for (size_t i = 0; i < tokens[t].size(); i++) {
+                auto s = sessions.find(tokens[t][i]);
+                if (!s || s->user != "user" + to_string(t + (int)i * THREADS)) misses++;
+            }
+    });
+    size_t live = sessions.size();
+
+    // Keep one thread's sessions active while the rest go idle.
+    for (int tick = 0; tick < 2 * IDLE; tick++) {
+        sessions.advance();
+        if (tick % (IDLE / 2) == 0)
+            for (auto &tok : tokens[0]) sessions.find(tok);
+    }
+    size_t kept = sessions.size();
+    bool ok = misses == 0 && live == (size_t)n && kept == tokens[0].size();
+
+    cout << BOLD << n << " sessions, " << THREADS << " threads\n" << RESET << fixed << setprecision(1);
+    cout << "create: " << tCreate << " ms, lookups: " << LOOKUPS * (double)n / max(tFind, 1e-6) / 1e3 << "M/s\n";
+    cout << "after " << 2 * IDLE << " idle ticks: " << kept << " live (expected " << tokens[0].size() << ")\n";
+    cout << (ok ? GREEN "Sessions resolved and expired as expected.\n" : RED "Session check failed!\n") << RESET;
+    return ok ? 0 : 1;
+}
+
+// ================= User Class =================
+class User {
+public:
+    string username;
+    string password;
+    User(string u, string p) : username(u), password(p) {}
+    User() {}
+};
+
+// ================= Index Bundle =================
+// Every structure derived from the property vector. Rows are addressed by
+// position, so a bundle can be built for a snapshot away from the live
+// store and swapped in whole.
+struct Indexes {
+    GeoGrid geo;
+    NameTrie types, locations, owners;
+    TextIndex text;
+    ColumnStore columns;
+    MaterializedStats stats;
+    DedupIndex dedup;
+    ValueIndex value; // rows by price per sq.ft
+
+    void clear() {
+        dedup.clear();
+        value.clear();
+        geo.clear();
+        types.clear();
+        locations.clear();
+        owners.clear();
+        text.clear();
+        columns.clear();
+        stats.clear();
+    }
+
+    void add(int row, const Property &p) { add(row, p, p.description); }
+
+    // `description` is passed separately because it may be paged out.
+    void add(int row, const Property &p, const string &description) {
+        geo.add(row, p);
+        types.add(p.type, row);
+        locations.add(p.location, row);
+        owners.add(p.owner, row);
+        text.add(row, description);
+        columns.add(p);
+        if (!p.deleted) {
+            stats.add(columns.locationId[row], columns.typeId[row], p.price, p.area);
+            dedup.insert(contentHash(p), row);
+            value.add(row, columns.ppsf[row]);
+        }
+    }
+
+    // Tombstones a row in place; the entries themselves go at compaction.
+    void remove(int row, const Property &p) {
+        columns.live[row] = 0;
+        stats.remove(columns.locationId[row], columns.typeId[row], p.price, p.area);
+        dedup.erase(contentHash(p), row);
+    }
+};
+
+// ================= RealEstate Class =================
+class RealEstate {
+private:
+    vector<Property> properties;
+    vector<User> users;
+    BloomFilter userNames; // "no" skips the scan of users
+    PriceHistory history;
+    unordered_map<int, SavedSearch> savedSearches;
+    SavedSearchIndex searchIndex;
+    int nextSearchId = 1;
+    unordered_map<string, deque<string>> notifications; // per user, oldest first
+    static const size_t MAX_NOTIFICATIONS = 100;          // per user; older ones are dropped
+    const string userFile = "users.csv";
+    const string propertyFile = "properties.csv";
+    const string descriptionFile = "descriptions.csv";
+    const string journalFile = "properties.journal";
+    const string manifestFile = "properties.manifest";
+    const string historyFile = "price_history.csv"; // id,day,price; append-only
+    const string savedSearchFile = "saved_searches.csv"; // id,user,type,location,min,max
+    const string notificationFile = "notifications.csv"; // user,text
+    Indexes idx;
+    QueryCache queryCache;
+    unordered_map<int, int> rowOfId; // live listings only
+    int nextId = 1;
+    size_t tombstones = 0;
+    uint32_t snapshotGeneration = 0; // journal records are tagged with this
+    size_t journalRecords = 0;       // since the last snapshot
+    static const size_t CHECKPOINT_RECORDS = 4096;
+
+    // Guards everything above against the background compactor.
+    mutable mutex storeMutex;
+    condition_variable compactSignal;
+    unsigned long long generation = 0; // bumped by every mutation
+    bool stopping = false;
+    thread compactor;
+
+    unique_ptr<ShardCoordinator> shards; // optional partitioned copy of the live rows
+    unique_ptr<PagedHeap> cold;          // buffer-pool mode: descriptions live here
+    SessionManager sessions;             // logged-in clients, by token
+    AdmissionControl admission;          // rate limits and load shedding for searches
+    unique_ptr<WorkloadRecorder> recorder; // set by --record
+
+    PersistenceWorker persist; // every write to the files above goes through here
+
+public:
+    // A non-zero `descCacheBytes` turns on buffer-pool mode (see Cold
+    // Storage) before anything is loaded; check paging() afterwards.
+    explicit RealEstate(size_t descCacheBytes = 0, size_t cacheBytes = 4 << 20) : queryCache(cacheBytes) {
+        if (descCacheBytes) {
+            cold.reset(new PagedHeap("descriptions.pages", descCacheBytes));
+            if (!cold->ok()) {
+                cout << RED << "Cannot create descriptions.pages\n" << RESET;
+                cold.reset();
+            }
+        }
+        loadUsers();
+        loadSavedSearches();
+        loadNotifications(); // before loadProperties, which may discard them
+        loadProperties();
+        compactor = thread([this] { compactorLoop(); });
+    }
+
+    ~RealEstate() {
+        {
+            lock_guard<mutex> lock(storeMutex);
+            stopping = true;
+        }
+        compactSignal.notify_all();
+        compactor.join();
+    }
+
+    // Waits until every queued save has reached the disk.
+    void flush() { persist.flush(); }
+
+    // Folds the journal into a fresh snapshot now instead of waiting for
+    // the compactor.
+    void checkpoint() {
+        lock_guard<mutex> lock(storeMutex);
+        saveProperties();
+    }
+
+    // Live listings as sorted CSV rows with their descriptions: two stores
+    // hold the same listings exactly when these match.
+    vector<string> listingRows() const {
+        lock_guard<mutex> lock(storeMutex);
+        vector<string> out;
+        for (auto &p : properties)
+            if (!p.deleted) out.push_back(csvLine(p) + "," + descriptionOf(p));
+        sort(out.begin(), out.end());
+        return out;
+    }
+
+    // ================= CSV File Handling =================
+    void loadUsers() {
+        ifstream fin(userFile);
+        if (!fin) return;
+        string line;
+        while (getline(fin, line)) {
+            stringstream ss(line);
+            string u, p;
+            getline(ss, u, ',');
+            getline(ss, p, ',');
+            if (!u.empty() && !p.empty())
+                users.push_back(User(u, p));
+        }
+        fin.close();
+        rebuildUserFilter();
+    }
+
+    // Sized for twice the current user count, so registrations rarely
+    // trigger a rebuild.
+    void rebuildUserFilter() {
+        userNames = BloomFilter(max<size_t>(1024, users.size() * 2), bloomConfig.fpRate);
+        for (auto &user : users) userNames.add(user.username);
+    }
+
+    void rememberUser(const string &name) {
+        if (userNames.full()) rebuildUserFilter();
+        else userNames.add(name);
+    }
+
+    void saveUsers() {
+        string out;
+        for (auto &user : users)
+            out += user.username + "," + user.password + "\n";
+        persist.rewrite(userFile, std::move(out));
+    }
+
+    void loadProperties() {
+        vector<size_t> sourceLines;
+        vector<uint64_t> hashes;
+        ImportReport report = streamProperties(propertyFile, [&](CsvRow &row) {
+            properties.push_back(std::move(row.p));
+            sourceLines.push_back(row.lineNo);
+            hashes.push_back(row.hash);
+        });
+        printImportReport(report);
+        Manifest manifest = Manifest::load(manifestFile);
+        snapshotGeneration = manifest.generation;
+        nextId = max(nextId, manifest.nextId);
+        size_t unnumbered = assignIds(sourceLines, !manifest.present);
+
+        // Rows without ids mean another program rewrote the file. main.cpp
+        // keeps every row's id and writes the listings it adds without
+        // one; those are numbered after the journal has claimed its ids.
+        // If no row has an id, whatever wrote the file dropped them, and
+        // nothing keyed by id (journal, descriptions, price history,
+        // notifications) refers to the right listing any more.
+        bool idsLost = manifest.present && !properties.empty() && unnumbered == properties.size();
+        bool rewrite = false;
+        if (idsLost) {
+            cout << YELLOW << "properties.csv was rewritten without listing IDs; pending edits, descriptions, price history "
+                            "and notifications were discarded.\n" << RESET;
+            persist.rewrite(historyFile, "");
+            notifications.clear();
+            saveNotifications();
+            rewrite = true;
+        } else {
+            loadPriceHistory();
+            loadDescriptions();
+            rewrite = !replayJournal();
+        }
+        for (auto &p : properties)
+            if (p.id <= 0) {
+                p.id = nextId++;
+                rewrite = true;
+            }
+        // A mismatch means the crash fell between writing the property file
+        // and its manifest; the replay above was idempotent, so just
+        // write a consistent snapshot.
+        string snapshot = readFile(propertyFile, false);
+        if (manifest.present && crc32(snapshot.data(), snapshot.size()) != manifest.crc)
+            rewrite = true;
+        size_t collapsed = collapseDuplicates(hashes);
+        reindex();
+        // Journal rows and merged duplicates carry their descriptions in memory.
+        for (auto &p : properties)
+            if (!p.deleted) pageOut(p);
+        if (collapsed)
+            cout << YELLOW << "Collapsed " << collapsed << " duplicate listing(s).\n" << RESET;
+        if (collapsed || rewrite || !manifest.present)
+            saveProperties();
+    }
+
+    // Keeps the first copy of each identical listing, folding in any
+    // description or coordinates only a later copy carries. Hashes were
+    // computed by the load pipeline; journal rows are hashed here. A row
+    // whose hash collides with a different listing is kept as it is.
+    size_t collapseDuplicates(vector<uint64_t> &hashes) {
+        for (size_t i = hashes.size(); i < properties.size(); i++)
+            hashes.push_back(contentHash(properties[i]));
+        DedupIndex seen;
+        size_t collapsed = 0;
+        for (int i = 0; i < (int)properties.size(); i++) {
+            if (properties[i].deleted) continue;
+            int first = seen.find(hashes[i]);
+            if (first < 0) {
+                seen.insert(hashes[i], i);
+                continue;
+            }
+            if (!sameContent(properties[first], properties[i])) continue;
+            mergeMissing(properties[first], properties[i]);
+            tombstone(i);
+            collapsed++;
+        }
+        return collapsed;
+    }
+
+    // Copies fields `from` has and `into` lacks; true if anything changed.
+    // Both may carry paged-out descriptions.
+    bool mergeMissing(Property &into, const Property &from) {
+        bool changed = false;
+        if (!hasDescription(into) && hasDescription(from)) {
+            into.description = descriptionOf(from);
+            into.descOffset = -1;
+            changed = true;
+        }
+        if (!into.hasCoords && from.hasCoords) {
+            into.hasCoords = true;
+            into.lat = from.lat;
+            into.lon = from.lon;
+            changed = true;
+        }
+        return changed;
+    }
+
+    // Rows written before ids existed (`byLine`: there is no manifest yet)
+    // take their line number, which is also how their descriptions were
+    // keyed; clashes get fresh ids. Otherwise rows without an id of their
+    // own are left at 0 for loadProperties to number. Returns how many
+    // rows had no id of their own.
+    size_t assignIds(const vector<size_t> &sourceLines, bool byLine) {
+        size_t unnumbered = 0;
+        unordered_map<int, int> seen;
+        for (auto &p : properties)
+            if (p.id > 0) seen[p.id]++;
+        for (auto &s : seen)
+            nextId = max(nextId, s.first + 1);
+        for (size_t i = 0; i < properties.size(); i++) {
+            Property &p = properties[i];
+            if (p.id > 0 && seen[p.id] == 1) continue;
+            if (p.id > 0) seen[p.id]--;
+            else unnumbered++;
+            if (!byLine) {
+                p.id = 0;
+                continue;
+            }
+            int line = (int)sourceLines[i];
+            p.id = seen.count(line) ? nextId++ : line;
+            seen[p.id] = 1;
+            nextId = max(nextId, p.id + 1);
+        }
+        rowOfId.clear();
+        for (int i = 0; i < (int)properties.size(); i++)
+            if (properties[i].id > 0) rowOfId[properties[i].id] = i;
+        return unnumbered;
+    }
+
+    // Rewrites the property file with live rows only and empties the
+    // journal, since everything it recorded is now in the file.
+    void saveProperties() {
+        writeSnapshot(formatProperties(properties), formatDescriptions(properties), rowOfId.size());
+    }
+
+    // Queues one snapshot as a single job, in the order the Manifest
+    // comment relies on, and starts a new journal generation.
+    void writeSnapshot(string props, string descs, size_t rows) {
+        Manifest next;
+        next.generation = snapshotGeneration + 1;
+        next.crc = crc32(props.data(), props.size());
+        next.rows = rows;
+        next.nextId = nextId;
+        persist.submit({{descriptionFile, std::move(descs), false},
+                        {propertyFile, std::move(props), false},
+                        {manifestFile, next.format(), false},
+                        {journalFile, "", false}});
+        snapshotGeneration = next.generation;
+        journalRecords = 0;
+    }
+
+    static string formatProperties(const vector<Property> &rows) {
+        string out;
+        for (auto &p : rows)
+            if (!p.deleted) CsvWriter::appendRow(out, p);
+        return out;
+    }
+
+    void loadPriceHistory() {
+        ifstream fin(historyFile);
+        int id, day, price;
+        char c1, c2;
+        while (fin >> id >> c1 >> day >> c2 >> price)
+            history.record(id, day, price);
+    }
+
+    void recordPrice(const Property &p, int day = today()) {
+        if (history.record(p.id, day, p.price))
+            persist.append(historyFile, to_string(p.id) + "," + to_string(day) + "," + to_string(p.price) + "\n");
+    }
+
+    // Listings loaded before history was kept have no series; their
+    // current price is all we know.
+    int priceOn(const Property &p, int day) const {
+        return history.has(p.id) ? history.priceAsOf(p.id, day) : p.price;
+    }
+
+    void loadSavedSearches() {
+        ifstream fin(savedSearchFile);
+        string line;
+        while (getline(fin, line)) {
+            stringstream ss(line);
+            SavedSearch s;
+            string f[6];
+            for (auto &field : f) getline(ss, field, ',');
+            if (!parseInt(f[0], s.id) || f[1].empty() || !parseInt(f[4], s.minPrice) || !parseInt(f[5], s.maxPrice))
+                continue;
+            s.user = f[1];
+            s.type = f[2];
+            s.location = f[3];
+            savedSearches[s.id] = s;
+            searchIndex.add(s);
+            nextSearchId = max(nextSearchId, s.id + 1);
+        }
+    }
+
+    void saveSavedSearches() {
+        string out;
+        for (auto &e : savedSearches) {
+            const SavedSearch &s = e.second;
+            out += to_string(s.id) + "," + s.user + "," + s.type + "," + s.location + "," + to_string(s.minPrice) + "," +
+                   to_string(s.maxPrice) + "\n";
+        }
+        persist.rewrite(savedSearchFile, std::move(out));
+    }
+
+    void loadNotifications() {
+        ifstream fin(notificationFile);
+        string line;
+        while (getline(fin, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            size_t comma = line.find(',');
+            if (comma != string::npos) notifications[line.substr(0, comma)].push_back(line.substr(comma + 1));
+        }
+    }
+
+    void saveNotifications() {
+        string out;
+        for (auto &e : notifications)
+            for (auto &text : e.second) out += e.first + "," + text + "\n";
+        persist.rewrite(notificationFile, std::move(out));
+    }
+
+    // Queues a message for every other user whose saved search the listing
+    // now matches.
+    void notifyMatches(const Property &p, const char *what) {
+        bool any = false;
+        for (int id : searchIndex.match(p)) {
+            const SavedSearch &s = savedSearches[id];
+            if (s.user == p.owner) continue;
+            deque<string> &queue = notifications[s.user];
+            queue.push_back(string(what) + " listing ID " + to_string(p.id) + ": " + p.type + " in " + p.location + " for " +
+                            to_string(p.price) + " matches your saved search " + s.describe());
+            if (queue.size() > MAX_NOTIFICATIONS) queue.pop_front();
+            any = true;
+        }
+        if (any) saveNotifications();
+    }
+
+    // descriptions.csv holds "id,text" pairs; text runs to the end of the
+    // line. In buffer-pool mode each text goes straight to the page file,
+    // so only one line is ever held in memory.
+    void loadDescriptions() {
+        ifstream fin(descriptionFile);
+        if (!fin) return;
+        string line;
+        while (getline(fin, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            size_t comma = line.find(',');
+            if (comma == string::npos) continue;
+            auto it = rowOfId.find(atoi(line.c_str()));
+            if (it == rowOfId.end()) continue;
+            Property &p = properties[it->second];
+            if (cold && comma + 1 < line.size()) {
+                p.descOffset = (long long)cold->append(line.data() + comma + 1, line.size() - comma - 1);
+                p.descLength = (unsigned)(line.size() - comma - 1);
+                string().swap(p.description);
+            } else {
+                p.description = line.substr(comma + 1);
+            }
+        }
+    }
+
+    string formatDescriptions(const vector<Property> &rows) const {
+        string out;
+        for (auto &p : rows)
+            if (!p.deleted && hasDescription(p))
+                out += to_string(p.id) + "," + scanDescriptionOf(p) + "\n";
+        return out;
+    }
+
+    // ================= Cold Storage =================
+    // With --desc-cache BYTES, descriptions are streamed from
+    // descriptions.csv into a PagedHeap at startup, and new ones are moved
+    // there once indexed; all are read back through its page cache. The
+    // other Property fields stay resident; type, location and owner are
+    // usually short enough to sit in the string's inline buffer. Saving
+    // still builds descriptions.csv in memory until the write completes;
+    // it, compaction and reindexing read the page file around the cache.
+    static bool hasDescription(const Property &p) { return p.descOffset >= 0 || !p.description.empty(); }
+
+    string descriptionOf(const Property &p) const {
+        return p.descOffset >= 0 ? cold->read(p.descOffset, p.descLength) : p.description;
+    }
+
+    // descriptionOf for passes over the whole table, bypassing the cache.
+    string scanDescriptionOf(const Property &p) const {
+        return p.descOffset >= 0 ? cold->readDirect(p.descOffset, p.descLength) : p.description;
+    }
+
+    void pageOut(Property &p) {
+        if (!cold || p.description.empty()) return;
+        p.descOffset = (long long)cold->append(p.description.data(), p.description.size());
+        p.descLength = (unsigned)p.description.size();
+        string().swap(p.description);
+    }
+
+    // ================= Workload Recording =================
+    void record(WorkloadEvent e) {
+        if (recorder) recorder->record(e);
+    }
+
+    // Saves the data files as they are now to TRACE.data/ (replay starts
+    // from there), then starts the trace.
+    bool startRecording(const string &path) {
+        lock_guard<mutex> lock(storeMutex);
+        persist.flush(); // nothing half-written, and nothing new while locked
+        error_code ec;
+        if (!copyDataFiles(".", workloadSnapshotDir(path), ec)) {
+            cout << RED << "Cannot save the data snapshot for " << path << ": " << ec.message() << "\n" << RESET;
+            return false;
+        }
+        recorder.reset(new WorkloadRecorder(path));
+        if (recorder->ok()) return true;
+        cout << RED << "Cannot write " << path << "\n" << RESET;
+        recorder.reset();
+        return false;
+    }
+
+    // Executes one traced event without prompting; output is expected to
+    // be silenced by the caller. `tokens` maps the trace's session numbers
+    // to sessions opened here and belongs to the calling thread.
+    void replay(const WorkloadEvent &e, unordered_map<uint32_t, string> &tokens) {
+        if (e.op == OP_LOGIN) {
+            tokens[e.session] = sessions.create(e.strs[0]);
+            return;
+        }
+        if (e.op == OP_LOGOUT) {
+            auto it = tokens.find(e.session);
+            if (it != tokens.end()) sessions.end(it->second), tokens.erase(it);
+            return;
+        }
+
+        lock_guard<mutex> lock(storeMutex);
+        switch (e.op) {
+            case OP_FILTER: runQuery(e.filter(0, 0)); break;
+            case OP_EXACT: findByPrice(e.ints[0]); break;
+            case OP_RADIUS: nearRows(e.ints[0] / 1e6, e.ints[1] / 1e6, e.ints[2] / 1e3, e.filter(3, 0)); break;
+            case OP_FUZZY: {
+                vector<int> names;
+                fuzzyRows(e.ints[0], e.strs[0], names);
+                break;
+            }
+            case OP_KEYWORD: keywordHits(e.strs[0], e.filter(0, 1)); break;
+            case OP_DROPS: priceDrops(today() - max(e.ints[0], 0)); break;
+            case OP_HISTORY: {
+                auto it = rowOfId.find(e.ints[0]);
+                if (it == rowOfId.end()) break;
+                history.points(e.ints[0]);
+                if (e.ints[1] >= 0) priceOn(properties[it->second], e.ints[1]);
+                break;
+            }
+            case OP_SIMILAR: {
+                auto it = rowOfId.find(e.ints[0]);
+                if (it != rowOfId.end()) similarListings(idx.columns, idx.geo, it->second, min(max(e.ints[1], 1), 100));
+                break;
+            }
+            case OP_VALUE: valueRows(e.ints[0], e.ints[1], e.filter(3, 0), e.ints[2]); break;
+            case OP_ADD: addListing(e.property(0, 0)); break;
+            case OP_UPDATE: {
+                Property p = e.property(1, 0);
+                int row = ownedRow(e.ints[0], p.owner);
+                if (row >= 0) replaceListing(row, p);
+                break;
+            }
+            case OP_DELETE: {
+                int row = ownedRow(e.ints[0], e.strs[0]);
+                if (row >= 0) removeListing(row);
+                break;
+            }
+        }
+    }
+
+    bool paging() const { return cold != nullptr; }
+
+    // ================= Journal =================
+    // Adds, updates and deletes are appended here instead of rewriting the
+    // property file: "D,id" tombstones a listing, "U,<csv row>,<description>"
+    // replaces one or, for an id not yet seen, creates it. Each entry is one checksummed record (see Record Log).
+    // The journal is replayed on load and emptied whenever the property
+    // file is rewritten; the compactor checkpoints after
+    // CHECKPOINT_RECORDS entries, which bounds how much a restart replays.
+    void appendJournal(const string &entry) {
+        persist.append(journalFile, encodeRecord(snapshotGeneration, entry));
+        if (++journalRecords >= CHECKPOINT_RECORDS) compactSignal.notify_one();
+    }
+
+    static string csvLine(const Property &p) {
+        string out;
+        CsvWriter::appendRow(out, p);
+        out.pop_back();
+        return out;
+    }
+
+    // Applies the journal's records for the current generation. Returns
+    // false if the journal needs rewriting (torn tail).
+    bool replayJournal() {
+        string bytes = readFile(journalFile, true);
+        vector<LogRecord> records;
+        size_t valid = decodeRecords(bytes, records);
+        for (auto &r : records)
+            if (r.generation == snapshotGeneration) {
+                applyJournalEntry(r.payload);
+                journalRecords++;
+            }
+        if (valid < bytes.size()) {
+            cout << YELLOW << "Discarded " << bytes.size() - valid << " byte(s) of torn journal tail.\n" << RESET;
+            return false;
+        }
+        return true;
+    }
+
+    void applyJournalEntry(const string &line) {
+        if (line.size() < 3 || line[1] != ',') return;
+        if (line[0] == 'D') {
+            auto it = rowOfId.find(atoi(line.c_str() + 2));
+            if (it != rowOfId.end()) tombstone(it->second);
+        } else if (line[0] == 'U') {
+            CsvRow row;
+            row.text = line.substr(2);
+            if (!parsePropertyLine(row) || !validateProperty(row) || row.p.id <= 0) return;
+            for (size_t i = 0, commas = 0; i < row.text.size(); i++)
+                if (row.text[i] == ',' && ++commas == 8) {
+                    row.p.description = row.text.substr(i + 1);
+                    break;
+                }
+            auto it = rowOfId.find(row.p.id);
+            if (it != rowOfId.end()) tombstone(it->second);
+            properties.push_back(row.p);
+            rowOfId[row.p.id] = (int)properties.size() - 1;
+            nextId = max(nextId, row.p.id + 1);
+        }
+    }
+
+    void printImportReport(const ImportReport &report) const {
+        if (report.rejected == 0) return;
+        cout << YELLOW << "Skipped " << report.rejected << " invalid line(s):\n";
+        for (auto &s : report.samples)
+            cout << "  " << s << "\n";
+        if (report.rejected > report.samples.size())
+            cout << "  ... and " << report.rejected - report.samples.size() << " more\n";
+        cout << RESET;
+    }
+
+    // ================= Indexes =================
+    // Derived structures refer to rows by position, so they are rebuilt
+    // whenever the vector is reordered and extended on every insert.
+    void reindex() {
+        idx.clear();
+        queryCache.clear();
+        rowOfId.clear();
+        tombstones = 0;
+        generation++;
+        for (int i = 0; i < (int)properties.size(); i++) {
+            idx.add(i, properties[i], scanDescriptionOf(properties[i]));
+            if (properties[i].deleted) tombstones++;
+            else rowOfId[properties[i].id] = i;
+        }
+    }
+
+    void indexRow(int row) {
+        queryCache.invalidate(properties[row]);
+        idx.add(row, properties[row], descriptionOf(properties[row]));
+        rowOfId[properties[row].id] = row;
+        if (shards) shards->insert(properties[row]);
+        pageOut(properties[row]);
+        generation++;
+    }
+
+    // O(1): flags the row and updates the running aggregates; nothing is
+    // shifted and the indexes keep the entry until compaction.
+    void tombstone(int row) {
+        Property &p = properties[row];
+        if (p.deleted) return;
+        queryCache.invalidate(p);
+        if (row < idx.columns.size()) idx.remove(row, p);
+        p.deleted = true;
+        rowOfId.erase(p.id);
+        if (shards) shards->remove(p);
+        tombstones++;
+        generation++;
+    }
+
+    // ================= Sharding =================
+    // shardSockets empty: shardCount in-process partitions. Otherwise one
+    // shard per socket path, each served by a `--shard-server` process.
+    bool enableSharding(int shardCount, const vector<string> &shardSockets) {
+        lock_guard<mutex> lock(storeMutex);
+        vector<unique_ptr<ShardClient>> clients;
+        if (shardSockets.empty()) {
+            for (int i = 0; i < shardCount; i++)
+                clients.emplace_back(new LocalShard(i));
+        } else {
+#ifndef _WIN32
+            signal(SIGPIPE, SIG_IGN); // a shard that dies must fail send(), not end this process
+            for (auto &path : shardSockets) {
+                SocketShard *remote = new SocketShard(path);
+                clients.emplace_back(remote);
+                if (!remote->ok()) {
+                    cout << RED << "Cannot connect to shard " << path << "\n" << RESET;
+                    return false;
+                }
+            }
+#else
+            cout << RED << "Shard processes need Unix sockets; use --shards N instead.\n" << RESET;
+            return false;
+#endif
+        }
+        if (clients.empty()) return false;
+        shards.reset(new ShardCoordinator(std::move(clients)));
+        for (auto &p : properties)
+            if (!p.deleted) shards->insert(p);
+        cout << GREEN << "Sharding enabled across " << shards->count() << " shard(s).\n" << RESET;
+        return true;
+    }
+
+    // ================= Compaction =================
+    bool needsCompaction() const {
+        return (tombstones > 0 && tombstones * 4 >= properties.size()) || journalRecords >= CHECKPOINT_RECORDS;
+    }
+
+    // Builds the compacted table, its indexes and its file contents from a
+    // snapshot without holding the store lock, then swaps them in if
+    // nothing changed meanwhile (otherwise retries on the next round).
+    void compactorLoop() {
+        unique_lock<mutex> lock(storeMutex);
+        while (!stopping) {
+            compactSignal.wait_for(lock, chrono::seconds(5));
+            if (stopping || !needsCompaction()) continue;
+
+            vector<Property> live;
+            for (auto &p : properties)
+                if (!p.deleted) live.push_back(p);
+            unsigned long long gen = generation;
+            lock.unlock();
+
+            // Written back in price order, so each zone covers a narrow
+            // price band and range scans skip most of the table.
+            stable_sort(live.begin(), live.end(), [](const Property &a, const Property &b) { return a.price < b.price; });
+
+            Indexes fresh;
+            for (int i = 0; i < (int)live.size(); i++)
+                fresh.add(i, live[i], scanDescriptionOf(live[i]));
+            string propsData = formatProperties(live), descsData = formatDescriptions(live);
+
+            lock.lock();
+            if (stopping || gen != generation) continue;
+            writeSnapshot(std::move(propsData), std::move(descsData), live.size());
+            properties.swap(live);
+            idx = std::move(fresh);
+            queryCache.clear();
+            rowOfId.clear();
+            for (int i = 0; i < (int)properties.size(); i++)
+                rowOfId[properties[i].id] = i;
+            tombstones = 0;
+            generation++;
+        }
+    }
+
+    // Rows matching the filter, in table order; repeated queries are
+    // served from the cache.
+    // What runQuery will touch: nothing on a cache hit, else the rows of
+    // every zone the filter overlaps.
+    QueryCost planQuery(const PropertyFilter &filter) const {
+        QueryCost cost;
+        if (queryCache.contains(filter.key())) {
+            cost.plan = "cached";
+            return cost;
+        }
+        const ColumnStore &cols = idx.columns;
+        for (int z = 0; z < (int)cols.zones.size(); z++)
+            if (cols.zones[z].overlaps(filter))
+                cost.rows += min((z + 1) * ColumnStore::ZONE_ROWS, cols.size()) - z * ColumnStore::ZONE_ROWS;
+        cost.plan = cost.rows == (size_t)cols.size() ? "full scan" : "zone-pruned scan";
+        return cost;
+    }
+
+    // Cells probed plus rows checked by withinRadius.
+    QueryCost planRadius(double lat, double lon, double radiusKm) const {
+        QueryCost cost;
+        cost.rows = idx.geo.costNear(lat, lon, radiusKm);
+        cost.plan = "grid cell scan";
+        return cost;
+    }
+
+    // The edit-distance walk can reach every trie node, and the names it
+    // matches can list every row filed in the trie.
+    QueryCost planFuzzy(int field) const {
+        const NameTrie &trie = field == 1 ? idx.types : field == 2 ? idx.locations : idx.owners;
+        QueryCost cost;
+        cost.rows = trie.nodeCount() + trie.rowCount();
+        cost.plan = "trie walk";
+        return cost;
+    }
+
+    QueryCost planKeyword(const string &query) const {
+        QueryCost cost;
+        cost.rows = idx.text.postingsFor(query);
+        cost.plan = "postings scan";
+        return cost;
+    }
+
+    QueryCost planDrops(int since) const {
+        QueryCost cost;
+        cost.rows = history.dropCountSince(since);
+        cost.plan = "drop log scan";
+        return cost;
+    }
 
-public:
-    RealEstate() {
-        loadUsers();
-        loadProperties();
+    QueryCost planHistory(int id) const {
+        QueryCost cost;
+        cost.rows = history.length(id);
+        cost.plan = "price series decode";
+        return cost;
     }
 
-    // ================= CSV File Handling =================
-    void loadUsers() {
-        ifstream fin(userFile);
-        if (!fin) return;
-        string line;
-        while (getline(fin, line)) {
-            stringstream ss(line);
-            string u, p;
-            getline(ss, u, ',');
-            getline(ss, p, ',');
-            if (!u.empty() && !p.empty())
-                users.push_back(User(u, p));
+    // What bubbleSortByPrice will touch: one pass when the table is in
+    // price order, up to n passes of n rows when it is not.
+    QueryCost planPriceSort() const {
+        QueryCost cost;
+        size_t n = properties.size();
+        bool sorted = is_sorted(properties.begin(), properties.end(),
+                                [](const Property &a, const Property &b) { return a.price < b.price; });
+        cost.rows = sorted ? n : n * n;
+        cost.plan = sorted ? "sort check" : "bubble sort";
+        return cost;
+    }
+
+    // Charges a query to the caller's bucket and, for an expensive plan,
+    // waits for a slot. The store lock is released meanwhile, so callers
+    // must not hold row numbers across this. False (with a message) if the
+    // query is refused.
+    bool admit(unique_lock<mutex> &lock, Session *session, const QueryCost &cost, AdmissionControl::Ticket &ticket) {
+        TokenBucket &bucket = session ? session->limiter : admission.anonymousBucket();
+        double retryAfter = 0;
+        lock.unlock();
+        AdmissionControl::Verdict verdict = admission.admit(bucket, cost, ticket, retryAfter);
+        lock.lock();
+        if (verdict == AdmissionControl::RATE_LIMITED) {
+            cout << RED << "Too many searches; try again in " << (int)ceil(retryAfter) << " s.\n" << RESET;
+            return false;
         }
-        fin.close();
+        if (verdict == AdmissionControl::OVERLOADED) {
+            cout << RED << "The server is busy with large searches (" << cost.plan << " of " << cost.rows
+                 << " rows); please narrow the search or try again shortly.\n" << RESET;
+            return false;
+        }
+        return true;
     }
 
-    void saveUsers() {
-        ofstream fout(userFile);
-        for (auto &user : users)
-            fout << user.username << "," << user.password << "\n";
-        fout.close();
+    vector<int> runQuery(const PropertyFilter &filter) {
+        string key = filter.key();
+        if (const vector<int> *cached = queryCache.get(key))
+            return *cached;
+        vector<int> rows;
+        const ColumnStore &cols = idx.columns;
+        CompiledScan scan(cols, filter);
+        for (int z = 0; z < (int)cols.zones.size(); z++)
+            if (cols.zones[z].overlaps(filter))
+                scan.run(cols, z * ColumnStore::ZONE_ROWS, min((z + 1) * ColumnStore::ZONE_ROWS, cols.size()), rows);
+        queryCache.put(filter, rows);
+        return rows;
     }
 
-    void loadProperties() {
-        ifstream fin(propertyFile);
-        if (!fin) return;
-        string line;
-        while (getline(fin, line)) {
-            stringstream ss(line);
-            Property p;
-            string priceStr, areaStr;
-            getline(ss, p.type, ',');
-            getline(ss, p.location, ',');
-            getline(ss, priceStr, ',');
-            getline(ss, areaStr, ',');
-            getline(ss, p.owner, ',');
-            if (!p.type.empty() && !priceStr.empty() && !areaStr.empty()) {
-                p.price = stoi(priceStr);
-                p.area = stoi(areaStr);
-                properties.push_back(p);
-            }
+    void showRows(const vector<int> &rows, bool &found) const {
+        printTableHeader();
+        int index = 1;
+        for (int row : rows)
+            properties[row].displayRow(index++);
+        printTableFooter();
+        found = !rows.empty();
+        if (found) showFacets(rows);
+    }
+
+    // "PUNE (4), SANGLI (2)" style counts for a result set.
+    void showFacets(const vector<int> &rows) const {
+        const char *labels[] = {"Types", "Locations"};
+        GroupField fields[] = {BY_TYPE, BY_LOCATION};
+        for (int f = 0; f < 2; f++) {
+            cout << CYAN << labels[f] << ":";
+            auto groups = aggregate(idx.columns, fields[f], &rows);
+            for (size_t i = 0; i < groups.size(); i++)
+                cout << (i ? ", " : " ") << groups[i].key << " (" << groups[i].count << ")";
+            cout << "\n" << RESET;
         }
-        fin.close();
     }
 
-    void saveProperties() {
-        ofstream fout(propertyFile);
-        for (auto &p : properties)
-            fout << p.type << "," << p.location << "," << p.price << ","
-                 << p.area << "," << p.owner << "\n";
-        fout.close();
+    // Constant-time lookup in the materialized (location, type) aggregates.
+    void showSummary() const {
+        string loc, t;
+        cout << WHITE << "Enter location (ANY for all): " << RESET;
+        cin >> loc;
+        cout << WHITE << "Enter property type (ANY for all): " << RESET;
+        cin >> t;
+        loc = toUpperCase(loc);
+        t = toUpperCase(t);
+        int locationId = loc == "ANY" ? -1 : idx.columns.locations.find(loc);
+        int typeId = t == "ANY" ? -1 : idx.columns.types.find(t);
+        const Aggregate *a = nullptr;
+        if ((loc == "ANY" || locationId >= 0) && (t == "ANY" || typeId >= 0))
+            a = idx.stats.get(locationId, typeId);
+        if (!a) {
+            cout << RED << "No matching properties found.\n" << RESET;
+            return;
+        }
+        cout << GREEN << "Count: " << a->count << "\n"
+             << "Min Price: " << a->minPrice << "\n"
+             << "Max Price: " << a->maxPrice << "\n"
+             << "Avg Price: " << a->priceSum / a->count << "\n"
+             << "Total Price: " << a->priceSum << "\n"
+             << "Total Area: " << a->areaSum << " sq.ft\n" << RESET;
+        if (a->boundsStale)
+            cout << YELLOW << "(min/max may include deleted listings until the next compaction)\n" << RESET;
+    }
+
+    void showStatistics() const {
+        lock_guard<mutex> lock(storeMutex);
+        int field;
+        cout << CYAN << "Group by:\n1. Type\n2. Location\n3. Owner\n4. Location & Type Summary\n5. Description Cache\n6. Search Admission\nEnter choice: " << RESET;
+        cin >> field;
+        if (field == 4) {
+            showSummary();
+            return;
+        }
+        if (field == 6) {
+            admission.report();
+            return;
+        }
+        if (field == 5) {
+            if (cold) cold->report();
+            else cout << YELLOW << "Descriptions are all in memory (start with --desc-cache BYTES to page them).\n" << RESET;
+            return;
+        }
+        if (field < BY_TYPE || field > BY_OWNER) {
+            cout << RED << "Invalid choice!\n" << RESET;
+            return;
+        }
+        auto groups = aggregate(idx.columns, (GroupField)field);
+        if (groups.empty()) {
+            cout << RED << "No properties available.\n" << RESET;
+            return;
+        }
+        cout << CYAN << "+---------------+-------+-------------+-------------+-------------+---------------+-----------+\n";
+        cout << "| Group         | Count | Min Price   | Max Price   | Avg Price   | Total Price   | Price/sqft|\n";
+        cout << "+---------------+-------+-------------+-------------+-------------+---------------+-----------+\n" << RESET;
+        for (auto &g : groups)
+            cout << BLUE << "| " << left << setw(13) << g.key << " | " << setw(5) << g.count << " | "
+                 << setw(11) << g.minPrice << " | " << setw(11) << g.maxPrice << " | "
+                 << setw(11) << fixed << setprecision(0) << g.meanPrice() << " | " << setw(13) << g.priceSum << " | "
+                 << setw(9) << setprecision(2) << g.pricePerSqft() << " |\n" << RESET;
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+        cout << CYAN << "+---------------+-------+-------------+-------------+-------------+---------------+-----------+\n" << RESET;
     }
 
     // ================= Core Functions =================
@@ -144,50 +4964,149 @@ public:
         cout << WHITE << "Enter username: " << RESET;
         cin >> u;
 
-        for (auto &user : users)
-            if (user.username == u) {
-                cout << RED << "Username already exists!\n" << RESET;
-                return false;
-            }
+        if (userNames.mayContain(u))
+            for (auto &user : users)
+                if (user.username == u) {
+                    cout << RED << "Username already exists!\n" << RESET;
+                    return false;
+                }
 
         cout << WHITE << "Enter password: " << RESET;
         cin >> p;
         users.push_back(User(u, p));
+        rememberUser(u);
         saveUsers();
         cout << GREEN << "User registered successfully!\n" << RESET;
         return true;
     }
 
-    bool loginUser(string &loggedUser) {
+    // On success `token` names a new session for the user.
+    bool loginUser(string &token) {
         string u, p;
         cout << GREEN << "Enter username: " << RESET;
         cin >> u;
         cout << RED << "Enter password: " << RESET;
         cin >> p;
 
-        for (auto &user : users)
-            if (user.username == u && user.password == p) {
-                loggedUser = u;
-                cout << GREEN << "Login successful!\n" << RESET;
-                return true;
-            }
+        if (userNames.mayContain(u))
+            for (auto &user : users)
+                if (user.username == u && user.password == p) {
+                    token = sessions.create(u);
+                    record(WorkloadEvent(OP_LOGIN, sessions.find(token)->serial, {}, {u}));
+                    cout << GREEN << "Login successful!\n" << RESET;
+                    return true;
+                }
 
         cout << RED << "Invalid username or password!\n" << RESET;
         return false;
     }
 
-    void addProperty(const string &username) {
+    shared_ptr<Session> session(const string &token) { return sessions.find(token); }
+
+    void logout(const string &token) {
+        if (auto s = sessions.find(token)) record(WorkloadEvent(OP_LOGOUT, s->serial));
+        sessions.end(token);
+    }
+
+    void addProperty(Session &session) {
+        lock_guard<mutex> lock(storeMutex);
         Property p;
-        p.input(username);
+        p.input(session.user);
+        record(WorkloadEvent(OP_ADD, session.serial).withProperty(p));
+        addListing(p);
+    }
+
+    // Adds a listing, or folds it into an identical one; the store lock is held.
+    void addListing(Property p) {
+        int dup = idx.dedup.find(contentHash(p));
+        if (dup >= 0 && sameContent(properties[dup], p)) {
+            Property merged = properties[dup];
+            if (!mergeMissing(merged, p)) {
+                cout << RED << "An identical listing already exists (ID " << merged.id << "); not added.\n" << RESET;
+                return;
+            }
+            tombstone(dup);
+            properties.push_back(merged);
+            indexRow((int)properties.size() - 1);
+            appendJournal("U," + csvLine(merged) + "," + descriptionOf(merged));
+            compactSignal.notify_one();
+            cout << YELLOW << "Merged the new details into identical listing ID " << merged.id << ".\n" << RESET;
+            return;
+        }
+
+        p.id = nextId++;
         properties.push_back(p);
-        saveProperties();
-        cout << GREEN << "Property added successfully!\n" << RESET;
+        indexRow((int)properties.size() - 1);
+        recordPrice(p);
+        appendJournal("U," + csvLine(p) + "," + p.description); // replay creates unknown ids
+        notifyMatches(p, "New");
+        cout << GREEN << "Property added successfully! (ID " << p.id << ")\n" << RESET;
+    }
+
+    // Row of a live listing owned by username, or -1 with a message.
+    int ownedRow(int id, const string &username) const {
+        auto it = rowOfId.find(id);
+        if (it == rowOfId.end() || properties[it->second].owner != username) {
+            cout << RED << "No property with that ID among your listings!\n" << RESET;
+            return -1;
+        }
+        return it->second;
+    }
+
+    // Tombstones the old version and appends the new one under the same
+    // id; only a journal line is written.
+    void updateProperty(Session &session) {
+        lock_guard<mutex> lock(storeMutex);
+        int id;
+        cout << WHITE << "Enter property ID to edit: " << RESET;
+        cin >> id;
+        int row = ownedRow(id, session.user);
+        if (row < 0) return;
+
+        Property p;
+        p.input(session.user);
+        WorkloadEvent e(OP_UPDATE, session.serial, {id});
+        record(e.withProperty(p));
+        replaceListing(row, p);
+    }
+
+    // The store lock is held and `row` is the live version of the listing.
+    void replaceListing(int row, Property p) {
+        int id = p.id = properties[row].id;
+        if (!history.has(id)) recordPrice(properties[row], 0); // old price, in force since before history
+        tombstone(row);
+        properties.push_back(p);
+        indexRow((int)properties.size() - 1);
+        recordPrice(p);
+        appendJournal("U," + csvLine(p) + "," + p.description);
+        notifyMatches(p, "Updated");
+        compactSignal.notify_one();
+        cout << GREEN << "Property updated successfully!\n" << RESET;
+    }
+
+    void deleteProperty(Session &session) {
+        lock_guard<mutex> lock(storeMutex);
+        int id;
+        cout << WHITE << "Enter property ID to delete: " << RESET;
+        cin >> id;
+        int row = ownedRow(id, session.user);
+        if (row < 0) return;
+        record(WorkloadEvent(OP_DELETE, session.serial, {id}, {session.user}));
+        removeListing(row);
+    }
+
+    void removeListing(int row) {
+        int id = properties[row].id;
+        tombstone(row);
+        appendJournal("D," + to_string(id));
+        compactSignal.notify_one();
+        cout << GREEN << "Property deleted successfully!\n" << RESET;
     }
 
     // ================= Display Utilities =================
-    void printTableHeader() const {
+    void printTableHeader(bool showIds = false) const {
         cout << CYAN << "+-----+---------------+---------------+-------------+-----------+---------------+\n";
-        cout << "| No. | Type          | Location      | Price       | Area      | Owner         |\n";
+        cout << (showIds ? "| ID " : "| No.") << " | Type          | Location      | Price       | Area      | Owner         |\n";
         cout << "+-----+---------------+---------------+-------------+-----------+---------------+\n" << RESET;
     }
 
@@ -196,14 +5115,92 @@ public:
     }
 
     // ================= Sorting & Searching =================
+    // Stops after the first pass without a swap, so a table already in
+    // price order costs one pass.
     void bubbleSortByPrice() {
         int n = properties.size();
+        bool changed = false;
         for (int i = 0; i < n - 1; i++) {
+            bool swapped = false;
             for (int j = 0; j < n - i - 1; j++) {
-                if (properties[j].price > properties[j + 1].price)
+                if (properties[j].price > properties[j + 1].price) {
                     swap(properties[j], properties[j + 1]);
+                    swapped = true;
+                }
             }
+            if (!swapped) break;
+            changed = true;
+        }
+        if (changed) reindex();
+    }
+
+    // Row of a live listing at exactly `price`, or -1. Sorts first.
+    int findByPrice(int price) {
+        bubbleSortByPrice();
+        int result = binarySearchByPrice(price);
+        // The probe may land on a tombstone; any live row in the run of
+        // equal prices around it will do.
+        if (result != -1 && properties[result].deleted) {
+            int l = result, r = result, n = properties.size();
+            while (l > 0 && properties[l - 1].price == price) l--;
+            while (r + 1 < n && properties[r + 1].price == price) r++;
+            result = -1;
+            for (int i = l; i <= r && result == -1; i++)
+                if (!properties[i].deleted) result = i;
+        }
+        return result;
+    }
+
+    // Rows within radiusKm matching the filter, nearest first.
+    vector<int> nearRows(double lat, double lon, double radiusKm, const PropertyFilter &filter) const {
+        vector<int> rows;
+        for (auto &hit : idx.geo.withinRadius(lat, lon, radiusKm))
+            if (filter.matches(properties[hit.second])) rows.push_back(hit.second);
+        return rows;
+    }
+
+    // Live rows whose type (1), location (2) or owner (3) starts with or
+    // is within two edits of `term`; `names` gets the matched trie ids.
+    vector<int> fuzzyRows(int field, const string &term, vector<int> &names) const {
+        const NameTrie &trie = field == 1 ? idx.types : field == 2 ? idx.locations : idx.owners;
+        names = trie.withPrefix(term, 20);
+        for (auto &hit : trie.similar(term, 2))
+            if (find(names.begin(), names.end(), hit.second) == names.end())
+                names.push_back(hit.second);
+        vector<int> rows;
+        for (int id : names)
+            for (int row : trie.rowsOf(id))
+                if (!properties[row].deleted) rows.push_back(row);
+        return rows;
+    }
+
+    vector<pair<double, int>> keywordHits(const string &query, const PropertyFilter &filter) const {
+        return idx.text.search(query, 20, [&](int row) { return filter.matches(properties[row]); });
+    }
+
+    // Live listings now cheaper than before `since`, as (id, price then).
+    vector<pair<int, int>> priceDrops(int since) const {
+        vector<pair<int, int>> changes;
+        for (int id : history.droppedSince(since)) {
+            auto it = rowOfId.find(id);
+            if (it == rowOfId.end()) continue;
+            const Property &p = properties[it->second];
+            int before = priceOn(p, since - 1);
+            if (before < 0 || p.price >= before) continue; // new in the window, or back up since
+            changes.push_back({id, before});
         }
+        return changes;
+    }
+
+    // Live rows with price per sq.ft in [lo, hi] (fixed point) matching
+    // the filter, best value first; at most k of them unless k is 0.
+    vector<int> valueRows(int lo, int hi, const PropertyFilter &filter, int k) const {
+        vector<int> rows;
+        idx.value.scan(lo, hi, [&](int, int row) {
+            if (idx.columns.live[row] && filter.matches(properties[row])) rows.push_back(row);
+            return k <= 0 || (int)rows.size() < k;
+        });
+        return rows;
     }
 
     int binarySearchByPrice(int price) {
@@ -220,25 +5217,106 @@ public:
         return -1;
     }
 
+    // ================= Saved Searches =================
+    void savedSearchesMenu(const string &username) {
+        lock_guard<mutex> lock(storeMutex);
+        int choice;
+        cout << YELLOW << "1. New Saved Search\n" << CYAN << "2. List My Saved Searches\n" << RED << "3. Delete Saved Search\n"
+             << WHITE << "Enter choice: " << RESET;
+        cin >> choice;
+        if (choice == 1) {
+            SavedSearch s;
+            string loc;
+            cout << WHITE << "Enter location (ANY for all): " << RESET;
+            cin >> loc;
+            PropertyFilter f = readFilter();
+            s.id = nextSearchId++;
+            s.user = username;
+            s.type = f.type;
+            s.location = toUpperCase(loc) == "ANY" ? "" : toUpperCase(loc);
+            s.minPrice = f.minPrice;
+            s.maxPrice = f.maxPrice;
+            savedSearches[s.id] = s;
+            searchIndex.add(s);
+            saveSavedSearches();
+            cout << GREEN << "Saved search " << s.describe() << ". New matching listings will appear in Notifications.\n" << RESET;
+        } else if (choice == 2) {
+            bool any = false;
+            for (auto &e : savedSearches)
+                if (e.second.user == username) {
+                    cout << CYAN << e.second.describe() << "\n" << RESET;
+                    any = true;
+                }
+            if (!any) cout << YELLOW << "You have no saved searches.\n" << RESET;
+        } else if (choice == 3) {
+            int id;
+            cout << WHITE << "Enter saved search number: " << RESET;
+            cin >> id;
+            auto it = savedSearches.find(id);
+            if (it == savedSearches.end() || it->second.user != username) {
+                cout << RED << "No saved search with that number!\n" << RESET;
+                return;
+            }
+            searchIndex.remove(it->second);
+            savedSearches.erase(it);
+            saveSavedSearches();
+            cout << GREEN << "Saved search deleted.\n" << RESET;
+        } else {
+            cout << RED << "Invalid choice!\n" << RESET;
+        }
+    }
+
+    size_t pendingNotifications(const string &username) const {
+        lock_guard<mutex> lock(storeMutex);
+        auto it = notifications.find(username);
+        return it == notifications.end() ? 0 : it->second.size();
+    }
+
+    // Shows and clears the user's queue.
+    void showNotifications(const string &username) {
+        lock_guard<mutex> lock(storeMutex);
+        auto it = notifications.find(username);
+        if (it == notifications.end() || it->second.empty()) {
+            cout << YELLOW << "No new notifications.\n" << RESET;
+            return;
+        }
+        for (auto &text : it->second) cout << CYAN << "* " << text << "\n" << RESET;
+        notifications.erase(it);
+        saveNotifications();
+    }
+
     // ================= Property Display =================
-    void showAllProperties() {
-        if (properties.empty()) {
+    // Sorts the table first, so it is admitted like a search.
+    void showAllProperties(Session *session) {
+        unique_lock<mutex> lock(storeMutex);
+        AdmissionControl::Ticket ticket;
+        if (rowOfId.empty()) {
             cout << RED << "No properties available.\n" << RESET;
             return;
         }
+        if (!admit(lock, session, planPriceSort(), ticket)) return;
 
         bubbleSortByPrice();
         cout << BOLD << YELLOW << "\n=== All Properties (Sorted by Price) ===\n" << RESET;
         printTableHeader();
         int index = 1;
         for (auto &p : properties)
-            p.displayRow(index++);
+            if (!p.deleted)
+                p.displayRow(index++);
         printTableFooter();
     }
 
-    void searchProperty() {
+    // `session` is null for anonymous searches, which share one rate limit.
+    void searchProperty(Session *session) {
+        unique_lock<mutex> lock(storeMutex);
+        AdmissionControl::Ticket ticket;
+        uint32_t serial = session ? session->serial : 0;
         int choice;
-        cout << CYAN << "Search by:\n1."<<GREEN<<"Type\n2."<<YELLOW<<" Location\n3."<<RED<<" Price Range\n4."<<BLUE<<" Exact Price (Binary Search)\n"<<"Enter choice: " << RESET;
+        cout << CYAN << "Search by:\n1."<<GREEN<<"Type\n2."<<YELLOW<<" Location\n3."<<RED<<" Price Range\n4."<<BLUE<<" Exact Price (Binary Search)\n"
+             <<MAGENTA<<"5. Near Location (Radius)\n"<<CYAN<<"6. Fuzzy / Prefix (Type, Location, Owner)\n"
+             <<GREEN<<"7. Keyword Search (Descriptions)\n"<<YELLOW<<"8. All Shards (Sorted by Price)\n"
+                 <<RED<<"9. Recent Price Drops\n"<<BLUE<<"10. Price History (by ID)\n"<<MAGENTA<<"11. Similar Listings (by ID)\n"
+                 <<CYAN<<"12. Price per Sq.ft (Range / Best Value)\n"<<"Enter choice: " << RESET;
         cin >> choice;
 
         bool found = false;
@@ -246,64 +5324,289 @@ public:
             string t;
             cout << WHITE << "Enter property type: " << RESET;
             cin >> t;
-            t = toUpperCase(t);
+            PropertyFilter filter;
+            filter.type = toUpperCase(t);
+            record(WorkloadEvent(OP_FILTER, serial).withFilter(filter));
 
-            printTableHeader();
-            int index = 1;
-            for (auto &p : properties)
-                if (toUpperCase(p.type) == t) {
-                    p.displayRow(index++);
-                    found = true;
-                }
-            printTableFooter();
+            if (!admit(lock, session, planQuery(filter), ticket)) return;
+            showRows(runQuery(filter), found);
+            if (!found) suggest(idx.types, filter.type);
         } else if (choice == 2) {
             string loc;
             cout << WHITE << "Enter location: " << RESET;
             cin >> loc;
-            loc = toUpperCase(loc);
+            PropertyFilter filter;
+            filter.location = toUpperCase(loc);
+            record(WorkloadEvent(OP_FILTER, serial).withFilter(filter));
 
-            printTableHeader();
-            int index = 1;
-            for (auto &p : properties)
-                if (toUpperCase(p.location) == loc) {
-                    p.displayRow(index++);
-                    found = true;
-                }
-            printTableFooter();
+            if (!admit(lock, session, planQuery(filter), ticket)) return;
+            showRows(runQuery(filter), found);
+            if (!found) suggest(idx.locations, filter.location);
         } else if (choice == 3) {
-            int minPrice, maxPrice;
+            int minPrice, maxPrice, minArea, maxArea;
             cout << WHITE << "Enter minimum price: " << RESET;
             cin >> minPrice;
             cout << WHITE << "Enter maximum price: " << RESET;
             cin >> maxPrice;
+            cout << WHITE << "Enter minimum area (0 for none): " << RESET;
+            cin >> minArea;
+            cout << WHITE << "Enter maximum area (0 for none): " << RESET;
+            cin >> maxArea;
 
-            printTableHeader();
-            int index = 1;
-            for (auto &p : properties)
-                if (p.price >= minPrice && p.price <= maxPrice) {
-                    p.displayRow(index++);
-                    found = true;
-                }
-            printTableFooter();
+            PropertyFilter filter;
+            filter.minPrice = minPrice;
+            filter.maxPrice = maxPrice;
+            if (minArea > 0) filter.minArea = minArea;
+            if (maxArea > 0) filter.maxArea = maxArea;
+            record(WorkloadEvent(OP_FILTER, serial).withFilter(filter));
+            if (!admit(lock, session, planQuery(filter), ticket)) return;
+            showRows(runQuery(filter), found);
         } else if (choice == 4) {
-            if (properties.empty()) {
+            if (rowOfId.empty()) {
                 cout << RED << "No properties available.\n" << RESET;
                 return;
             }
 
-            bubbleSortByPrice();
-
             int price;
             cout << WHITE << "Enter exact price to search: " << RESET;
             cin >> price;
+            record(WorkloadEvent(OP_EXACT, serial, {price}));
 
-            int result = binarySearchByPrice(price);
+            if (!admit(lock, session, planPriceSort(), ticket)) return;
+
+            int result = findByPrice(price);
             if (result != -1) {
                 printTableHeader();
                 properties[result].displayRow(1);
                 printTableFooter();
                 found = true;
             }
+        } else if (choice == 5) {
+            string where;
+            double radius, lat, lon;
+            cout << WHITE << "Enter location or lat,lon: " << RESET;
+            cin >> where;
+            if (!parseCoords(where, lat, lon) && !lookupCity(where, lat, lon)) {
+                cout << RED << "Unknown location!\n" << RESET;
+                return;
+            }
+            cout << WHITE << "Enter radius (km): " << RESET;
+            cin >> radius;
+            if (!GeoGrid::validRadius(radius)) {
+                cout << RED << "Radius must be between 0 and " << GeoGrid::MAX_RADIUS_KM << " km!\n" << RESET;
+                return;
+            }
+
+            PropertyFilter filter = readFilter();
+            WorkloadEvent e(OP_RADIUS, serial, {WorkloadEvent::micro(lat), WorkloadEvent::micro(lon), (int)lround(radius * 1e3)});
+            record(e.withFilter(filter));
+            if (!admit(lock, session, planRadius(lat, lon, radius), ticket)) return;
+            printTableHeader();
+            int index = 1;
+            for (int row : nearRows(lat, lon, radius, filter)) {
+                properties[row].displayRow(index++);
+                found = true;
+            }
+            printTableFooter();
+        } else if (choice == 6) {
+            int field;
+            string term;
+            cout << WHITE << "Field (1. Type 2. Location 3. Owner): " << RESET;
+            cin >> field;
+            if (field < 1 || field > 3) {
+                cout << RED << "Invalid field!\n" << RESET;
+                return;
+            }
+            cout << WHITE << "Enter name, prefix or approximate spelling: " << RESET;
+            cin >> term;
+            record(WorkloadEvent(OP_FUZZY, serial, {field}, {term}));
+            if (!admit(lock, session, planFuzzy(field), ticket)) return;
+
+            const NameTrie &trie = field == 1 ? idx.types : field == 2 ? idx.locations : idx.owners;
+
+            vector<int> ids;
+            vector<int> rows = fuzzyRows(field, term, ids);
+            if (!ids.empty()) {
+                cout << CYAN << "Matched:";
+                for (int id : ids) cout << " " << trie.name(id);
+                cout << "\n" << RESET;
+            }
+
+            printTableHeader();
+            int index = 1;
+            for (int row : rows) {
+                properties[row].displayRow(index++);
+                found = true;
+            }
+            printTableFooter();
+        } else if (choice == 7) {
+            string query;
+            cout << WHITE << "Enter keywords: " << RESET;
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            getline(cin, query);
+            PropertyFilter filter = readFilter();
+            WorkloadEvent e(OP_KEYWORD, serial, {}, {query});
+            record(e.withFilter(filter));
+            if (!admit(lock, session, planKeyword(query), ticket)) return;
+
+            auto hits = keywordHits(query, filter);
+            printTableHeader();
+            int index = 1;
+            for (auto &hit : hits)
+                properties[hit.second].displayRow(index++);
+            printTableFooter();
+            index = 1;
+            for (auto &hit : hits)
+                cout << WHITE << index++ << ". " << descriptionOf(properties[hit.second]) << "\n" << RESET;
+            found = !hits.empty();
+        } else if (choice == 8) {
+            if (!shards) {
+                cout << RED << "Sharding is off (start with --shards N or --shard-sockets).\n" << RESET;
+                return;
+            }
+            string loc;
+            cout << WHITE << "Enter location (ANY for all): " << RESET;
+            cin >> loc;
+            PropertyFilter filter = readFilter();
+            filter.location = toUpperCase(loc) == "ANY" ? "" : toUpperCase(loc);
+            QueryCost cost;
+            cost.rows = rowOfId.size();
+            cost.plan = "shard fan-out";
+            if (!admit(lock, session, cost, ticket)) return;
+
+            printTableHeader();
+            int index = 1;
+            vector<string> failed;
+            for (auto &p : shards->search(filter, failed)) {
+                p.displayRow(index++);
+                found = true;
+            }
+            printTableFooter();
+            for (auto &name : failed)
+                cout << YELLOW << "Shard " << name << " did not answer; these results are partial.\n" << RESET;
+        } else if (choice == 9) {
+            int days;
+            cout << WHITE << "Dropped within the last how many days? " << RESET;
+            cin >> days;
+            record(WorkloadEvent(OP_DROPS, serial, {days}));
+            int since = today() - max(days, 0);
+            if (!admit(lock, session, planDrops(since), ticket)) return;
+
+            printTableHeader(true);
+            vector<pair<int, int>> changes = priceDrops(since);
+            for (auto &c : changes) {
+                const Property &p = properties[rowOfId[c.first]];
+                p.displayRow(p.id);
+                found = true;
+            }
+            printTableFooter();
+            for (auto &c : changes) {
+                int current = properties[rowOfId[c.first]].price;
+                cout << YELLOW << "ID " << c.first << ": " << c.second << " -> " << current << " (" << fixed
+                     << setprecision(1) << 100.0 * (current - c.second) / max(c.second, 1) << "%)\n" << RESET;
+            }
+        } else if (choice == 10) {
+            int id;
+            cout << WHITE << "Enter property ID: " << RESET;
+            cin >> id;
+            if (!admit(lock, session, planHistory(id), ticket)) return;
+            auto it = rowOfId.find(id);
+            if (it == rowOfId.end()) {
+                cout << RED << "No property with that ID!\n" << RESET;
+                return;
+            }
+            const Property &p = properties[it->second];
+            vector<PriceHistory::Point> points = history.points(id);
+            if (points.empty()) {
+                cout << YELLOW << "No price changes recorded; current price " << p.price << ".\n" << RESET;
+            } else {
+                for (auto &pt : points)
+                    cout << CYAN << (pt.day ? civilFromDays(pt.day) : "earlier   ") << "  " << pt.price << "\n" << RESET;
+            }
+            found = true;
+
+            string date;
+            cout << WHITE << "Price as of date (YYYY-MM-DD, or - to skip): " << RESET;
+            cin >> date;
+            int day;
+            bool asOf = date != "-" && parseDate(date, day);
+            record(WorkloadEvent(OP_HISTORY, serial, {id, asOf ? day : -1}));
+            if (asOf) {
+                int price = priceOn(p, day);
+                if (price < 0) cout << YELLOW << "Not listed yet on " << date << ".\n" << RESET;
+                else cout << GREEN << "Price on " << date << ": " << price << "\n" << RESET;
+            }
+        } else if (choice == 11) {
+            int id, k;
+            cout << WHITE << "Enter property ID: " << RESET;
+            cin >> id;
+            cout << WHITE << "How many similar listings? " << RESET;
+            cin >> k;
+            record(WorkloadEvent(OP_SIMILAR, serial, {id, k}));
+            QueryCost cost;
+            cost.rows = idx.columns.size();
+            cost.plan = "similarity scan";
+            if (!admit(lock, session, cost, ticket)) return;
+            auto it = rowOfId.find(id);
+            if (it == rowOfId.end()) {
+                cout << RED << "No property with that ID!\n" << RESET;
+                return;
+            }
+            auto start = chrono::steady_clock::now();
+            auto similar = similarListings(idx.columns, idx.geo, it->second, min(max(k, 1), 100));
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            printTableHeader(true);
+            properties[it->second].displayRow(id);
+            printTableFooter();
+            cout << CYAN << "Most similar first:\n" << RESET;
+            printTableHeader(true);
+            for (auto &s : similar) {
+                properties[s.second].displayRow(properties[s.second].id);
+                found = true;
+            }
+            printTableFooter();
+            cout << CYAN << "(" << fixed << setprecision(2) << ms << " ms over " << idx.columns.size() << " rows)\n"
+                 << RESET;
+        } else if (choice == 12) {
+            int mode, k = 0;
+            double minValue = 0, maxValue = 0;
+            PropertyFilter filter;
+            cout << WHITE << "1. Price per sq.ft range\n2. Best value (lowest price per sq.ft)\nEnter choice: " << RESET;
+            cin >> mode;
+            if (mode == 1) {
+                cout << WHITE << "Enter minimum price per sq.ft: " << RESET;
+                cin >> minValue;
+                cout << WHITE << "Enter maximum price per sq.ft (0 for none): " << RESET;
+                cin >> maxValue;
+            } else if (mode == 2) {
+                cout << WHITE << "How many listings? " << RESET;
+                cin >> k;
+                k = min(max(k, 1), 100);
+                filter = readFilter();
+            } else {
+                cout << RED << "Invalid choice!\n" << RESET;
+                return;
+            }
+            auto toFixed = [](double v) { return (int)min<double>(llround(max(v, 0.0) * PPSF_SCALE), INT_MAX); };
+            int lo = toFixed(minValue), hi = maxValue > 0 ? toFixed(maxValue) : INT_MAX;
+            WorkloadEvent e(OP_VALUE, serial, {lo, hi, k});
+            record(e.withFilter(filter));
+
+            QueryCost cost;
+            cost.rows = idx.value.countInRange(lo, hi);
+            cost.plan = "value index range";
+            if (!admit(lock, session, cost, ticket)) return;
+
+            vector<int> rows = valueRows(lo, hi, filter, k);
+            printTableHeader(true);
+            for (int row : rows)
+                properties[row].displayRow(properties[row].id);
+            printTableFooter();
+            for (int row : rows)
+                cout << YELLOW << "ID " << properties[row].id << ": " << formatPpsf(idx.columns.ppsf[row])
+                     << " per sq.ft\n" << RESET;
+            found = !rows.empty();
         } else {
             cout << RED << "Invalid choice!\n" << RESET;
             return;
@@ -313,67 +5616,444 @@ public:
             cout << RED << "No matching properties found.\n" << RESET;
     }
 
-    void showMyProperties(const string &username) const {
-        cout << BOLD << MAGENTA << "\n=== My Properties ===\n" << RESET;
-        bool found = false;
-        printTableHeader();
-        int index = 1;
-        for (auto &p : properties)
-            if (p.owner == username) {
-                p.displayRow(index++);
-                found = true;
+    void suggest(const NameTrie &trie, const string &term) const {
+        auto hits = trie.similar(term, 2);
+        if (hits.empty()) return;
+        cout << YELLOW << "Did you mean:";
+        for (size_t i = 0; i < hits.size() && i < 5; i++)
+            cout << " " << trie.name(hits[i].second);
+        cout << "?\n" << RESET;
+    }
+
+    PropertyFilter readFilter() const {
+        PropertyFilter f;
+        int minP, maxP;
+        cout << WHITE << "Filter by type (ANY for all): " << RESET;
+        cin >> f.type;
+        f.type = toUpperCase(f.type);
+        if (f.type == "ANY") f.type.clear();
+        cout << WHITE << "Enter minimum price (0 for none): " << RESET;
+        cin >> minP;
+        cout << WHITE << "Enter maximum price (0 for none): " << RESET;
+        cin >> maxP;
+        f.minPrice = max(0, minP);
+        if (maxP > 0) f.maxPrice = maxP;
+        return f;
+    }
+
+    // Streams straight from the file on disk, so exports are not limited by
+    // what fits in memory.
+    // Exports the live rows, so edits and deletes still waiting in the
+    // journal are reflected. Matches are copied under the lock and written
+    // after it is released.
+    void exportPropertiesMenu() {
+        string loc, path;
+        cout << WHITE << "Enter location to export (ALL for every listing): " << RESET;
+        cin >> loc;
+        loc = toUpperCase(loc);
+        cout << WHITE << "Enter output file name: " << RESET;
+        cin >> path;
+        if (path == propertyFile) {
+            cout << RED << "Cannot export over the property file!\n" << RESET;
+            return;
+        }
+
+        vector<Property> rows;
+        {
+            lock_guard<mutex> lock(storeMutex);
+            for (auto &p : properties)
+                if (!p.deleted && (loc == "ALL" || toUpperCase(p.location) == loc)) rows.push_back(p);
+        }
+        CsvWriter writer(path);
+        for (size_t i = 0; i < rows.size() && writer.ok(); i++) writer.write(rows[i]);
+        if (!writer.flush()) {
+            cout << RED << "Could not write " << path << "\n" << RESET;
+            return;
+        }
+        cout << GREEN << "Exported " << writer.rows << " properties to " << path << "\n" << RESET;
+    }
+
+    // Owners who never listed are answered by the dictionary alone; for the
+    // rest, zones whose owner filter says "no" are skipped.
+    // The rows are cached on the session until the store next changes.
+    void showMyProperties(Session &session) const {
+        lock_guard<mutex> lock(storeMutex);
+        const string &username = session.user;
+        if (session.myRowsGeneration != generation) {
+            session.myRows.clear();
+            const ColumnStore &cols = idx.columns;
+            for (int z = 0; z < (int)cols.zones.size() && cols.owners.find(username) >= 0; z++) {
+                if (!cols.zones[z].owners.mayContain(username)) continue;
+                int end = min((z + 1) * ColumnStore::ZONE_ROWS, cols.size());
+                for (int i = z * ColumnStore::ZONE_ROWS; i < end; i++)
+                    if (properties[i].owner == username && !properties[i].deleted) session.myRows.push_back(i);
             }
+            session.myRowsGeneration = generation;
+        }
+
+        cout << BOLD << MAGENTA << "\n=== My Properties ===\n" << RESET;
+        printTableHeader(true);
+        for (int i : session.myRows)
+            properties[i].displayRow(properties[i].id);
         printTableFooter();
-        if (!found)
+        if (session.myRows.empty())
             cout << YELLOW << "You have not added any properties yet.\n" << RESET;
     }
 };
 
+// ================= Fault Injection =================
+// `--fault-test N`: first the record decoder is fuzzed with torn and
+// corrupted logs. Then N rounds run against real files in a scratch
+// directory. A round seeds a few listings and applies a random run of
+// adds, updates and deletes (journal appends) and checkpoints (a full
+// snapshot: descriptions, property file, manifest, empty journal),
+// flushing after each. A clean pass sizes the run in file steps; a second pass kills the
+// worker at a random one (mid-write, or between two steps such as the
+// property-file rename and the manifest write). A store reopened on what
+// reached the disk must hold the listings from just before or just after
+// the operation that was cut short. Steps are counted per pass because
+// queued saves fold together depending on timing.
+int runFaultTest(int rounds) {
+    int failures = fuzzRecordDecoding(rounds);
+    cout << (failures ? RED : GREEN) << rounds - failures << "/" << rounds
+         << " torn logs decoded to a clean prefix.\n" << RESET;
+
+    error_code ec;
+    filesystem::path home = filesystem::current_path();
+    filesystem::path scratch = filesystem::temp_directory_path(ec) / ("realestate-fault-" + to_string(random_device()()));
+    filesystem::create_directories(scratch, ec);
+    if (ec) {
+        cout << RED << "Cannot create " << scratch.string() << ": " << ec.message() << "\n" << RESET;
+        return 1;
+    }
+    filesystem::current_path(scratch);
+
+    const char *TYPES[] = {"HOUSE", "FLAT", "PLOT"};
+    const char *LOCS[] = {"PUNE", "SANGLI", "THANE"};
+    mt19937 rng(2024);
+    int broken = 0;
+    // The store's messages, and the worker's complaints once it is "dead".
+    cout.setstate(ios::failbit);
+    cerr.setstate(ios::failbit);
+    for (int round = 0; round < rounds; round++) {
+        uint32_t seed = rng();
+        // One pass: fresh files, the seeded run, and the listings after the
+        // initial open and after each operation.
+        auto run = [&](vector<vector<string>> &states, vector<long> &stepsAfter) {
+            for (const char *f : DATA_FILES) filesystem::remove(f, ec);
+            for (const char *f : DATA_FILES) filesystem::remove(string(f) + ".tmp", ec);
+            mt19937 r(seed);
+            string seedRows;
+            for (int i = 0, n = 1 + r() % 4; i < n; i++)
+                seedRows += string(TYPES[r() % 3]) + "," + LOCS[r() % 3] + "," + to_string(1000 + r() % 90000) + "," +
+                            to_string(100 + r() % 900) + ",owner" + to_string(r() % 3) + ",,," + to_string(i + 1) + "\n";
+            writeFileSynced("properties.csv", seedRows.data(), seedRows.size(), false);
+
+            RealEstate app;
+            app.flush();
+            states.push_back(app.listingRows());
+            stepsAfter.push_back(faultInjection.steps);
+            for (int op = 0, ops = 4 + r() % 12; op < ops; op++) {
+                vector<string> live = states.back();
+                int kind = live.empty() ? 0 : r() % 4;
+                Property p;
+                p.type = TYPES[r() % 3];
+                p.location = LOCS[r() % 3];
+                p.price = 1000 + r() % 90000;
+                p.area = 100 + r() % 900;
+                p.owner = "owner" + to_string(r() % 3);
+                p.description = r() % 2 ? "corner plot " + to_string(r() % 100) : "";
+                unordered_map<uint32_t, string> tokens;
+                if (kind == 0) {
+                    app.replay(WorkloadEvent(OP_ADD, 0).withProperty(p), tokens);
+                } else if (kind == 3) {
+                    app.checkpoint();
+                } else {
+                    // id and owner are fields 8 and 5 of the chosen row
+                    vector<string> f;
+                    stringstream ss(live[r() % live.size()]);
+                    for (string part; f.size() < 8 && getline(ss, part, ',');) f.push_back(part);
+                    int id = atoi(f[7].c_str());
+                    p.owner = f[4];
+                    if (kind == 1) app.replay(WorkloadEvent(OP_UPDATE, 0, {id}).withProperty(p), tokens);
+                    else app.replay(WorkloadEvent(OP_DELETE, 0, {id}, {p.owner}), tokens);
+                }
+                app.flush();
+                states.push_back(app.listingRows());
+                stepsAfter.push_back(faultInjection.steps);
+            }
+        };
+
+        vector<vector<string>> expected;
+        vector<long> stepsAfter;
+        faultInjection = FaultInjection();
+        run(expected, stepsAfter);
+        expected.clear();
+        long total = stepsAfter.back();
+        stepsAfter.clear();
+
+        // Crash at a step anywhere from the first open's snapshot to the
+        // last operation, landing part of that step's bytes.
+        mt19937 r(seed ^ 0x9e3779b9u);
+        faultInjection = FaultInjection();
+        faultInjection.stepsLeft = 1 + (long)(r() % total);
+        faultInjection.tornBytes = r() % 2 ? r() % 64 : SIZE_MAX;
+        long crashStep = faultInjection.stepsLeft;
+        run(expected, stepsAfter); // listings in memory do not depend on the disk
+        bool crashed = faultInjection.stepsLeft == 0;
+        faultInjection = FaultInjection();
+
+        vector<string> recovered;
+        {
+            RealEstate reopened;
+            reopened.flush();
+            recovered = reopened.listingRows();
+        }
+        // The step fell inside operation k (0 = the first open's snapshot);
+        // before it the listings were the seed rows as loaded. If folding
+        // left fewer steps than the budget, everything landed.
+        size_t k = crashed ? lower_bound(stepsAfter.begin(), stepsAfter.end(), crashStep) - stepsAfter.begin()
+                           : expected.size() - 1;
+        bool ok = recovered == expected[k] || (crashed && k > 0 && recovered == expected[k - 1]);
+        if (!ok) {
+            broken++;
+            cout.clear();
+            cout << RED << "Round " << round << ": crash at file step " << crashStep << " (operation " << k
+                 << ") recovered " << recovered.size() << " listing(s) matching neither neighbouring state\n" << RESET;
+            cout.setstate(ios::failbit);
+        }
+    }
+    cout.clear();
+    cerr.clear();
+    filesystem::current_path(home);
+    filesystem::remove_all(scratch, ec);
+    cout << (broken ? RED : GREEN) << rounds - broken << "/" << rounds
+         << " simulated crashes recovered the listings from just before or after the interrupted operation.\n"
+         << RESET;
+    return failures || broken ? 1 : 0;
+}
+
+// ================= Workload Replay =================
+// `--replay TRACE [--speed N|max] [--threads M]`: copies the data files
+// saved with the trace into replay-snapshot/, opens a store there and
+// re-executes the trace.
+// Each session's events stay in order on one of M threads (anonymous ones
+// are dealt round-robin). At speed N events are issued at N times the
+// recorded pace and latency counts from the scheduled time, so falling
+// behind shows up; at max speed they are issued back to back.
+int runReplay(const string &trace, double speed, int threads) {
+    vector<WorkloadEvent> events;
+    if (!loadWorkload(trace, events)) {
+        cout << RED << "Not a workload trace: " << trace << "\n" << RESET;
+        return 1;
+    }
+    threads = max(threads, 1);
+
+    error_code ec;
+    filesystem::path saved = workloadSnapshotDir(trace);
+    if (!filesystem::is_directory(saved)) {
+        cout << RED << "No data snapshot for this trace (expected " << saved.string() << ")\n" << RESET;
+        return 1;
+    }
+    if (copyDataFiles(saved, "replay-snapshot", ec)) filesystem::current_path("replay-snapshot", ec);
+    if (ec) {
+        cout << RED << "Cannot prepare replay-snapshot/: " << ec.message() << "\n" << RESET;
+        return 1;
+    }
+
+    vector<vector<const WorkloadEvent *>> lanes(threads);
+    size_t anonymous = 0;
+    for (auto &e : events)
+        lanes[e.session ? e.session % threads : anonymous++ % threads].push_back(&e);
+
+    vector<vector<double>> latency(OP_COUNT); // ms, per op
+    mutex latencyMutex;
+    double wallMs;
+    {
+        cout.setstate(ios::failbit); // the store's own messages
+        RealEstate app;
+        auto start = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++)
+            pool.emplace_back([&, t] {
+                unordered_map<uint32_t, string> tokens;
+                vector<vector<double>> mine(OP_COUNT);
+                for (const WorkloadEvent *e : lanes[t]) {
+                    auto begin = chrono::steady_clock::now();
+                    if (speed > 0) {
+                        auto due = start + chrono::microseconds((int64_t)(e->atUs / speed));
+                        if (due > begin) this_thread::sleep_until(due);
+                        begin = min(max(begin, due), chrono::steady_clock::now());
+                    }
+                    app.replay(*e, tokens);
+                    mine[e->op].push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count());
+                }
+                lock_guard<mutex> lock(latencyMutex);
+                for (int op = 0; op < OP_COUNT; op++) latency[op].insert(latency[op].end(), mine[op].begin(), mine[op].end());
+            });
+        for (auto &th : pool) th.join();
+        wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        app.flush();
+    }
+    cout.clear();
+
+    auto pct = [](const vector<double> &v, double q) { return v.empty() ? 0 : v[(size_t)(q * (v.size() - 1))]; };
+    ostringstream pace;
+    if (speed > 0) pace << speed << "x";
+    else pace << "max speed";
+    cout << BOLD << "Replayed " << events.size() << " events on " << threads << " thread(s) at " << pace.str()
+         << ": " << fixed << setprecision(1)
+         << events.size() * 1000.0 / max(wallMs, 1e-6) << " ops/s over " << wallMs << " ms\n" << RESET;
+    cout << left << setw(10) << "op" << setw(10) << "count" << setw(10) << "p50 ms" << setw(10) << "p95 ms"
+         << "p99 ms\n" << setprecision(3);
+    vector<double> all;
+    for (int op = 1; op < OP_COUNT; op++) {
+        auto &v = latency[op];
+        if (v.empty()) continue;
+        sort(v.begin(), v.end());
+        all.insert(all.end(), v.begin(), v.end());
+        cout << setw(10) << WORKLOAD_OP_NAMES[op] << setw(10) << v.size() << setw(10) << pct(v, 0.5) << setw(10)
+             << pct(v, 0.95) << pct(v, 0.99) << "\n";
+    }
+    sort(all.begin(), all.end());
+    cout << setw(10) << "all" << setw(10) << all.size() << setw(10) << pct(all, 0.5) << setw(10) << pct(all, 0.95)
+         << pct(all, 0.99) << "\n";
+    return 0;
+}
+
 // ================= MAIN =================
-int main() {
-    RealEstate app;
-    string loggedUser = "";
+// Usage: code [--shards N | --shard-sockets PATH,PATH,...] [--bloom-fp RATE] [--bloom-bytes N]
+//             [--desc-cache BYTES] [--query-cache BYTES] [--search-rate TOKENS_PER_SEC] [--hugepages thp|explicit] [--numa]
+//        code --shard-server PATH
+//        code --fault-test ROUNDS | --bench-kernels ROWS | --bench-similar ROWS | --bench-sessions N
+//        code --bench-admission ROWS | --bench-memory ROWS [THREADS]
+//        code [--record TRACE] | --replay TRACE [--speed N|max] [--threads M]
+//        code --archive CSV OUT | --archive-scan ARCHIVE price|area|ppsf MIN MAX
+int main(int argc, char *argv[]) {
+    int shardCount = 0;
+    vector<string> shardSockets;
+    size_t descCacheBytes = 0;
+    size_t queryCacheBytes = 4 << 20;
+    string recordPath, replayPath;
+    double replaySpeed = 0; // max
+    int replayThreads = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--numa") {
+            memoryConfig.numa = true;
+            continue;
+        }
+        if (i + 1 == argc) break;
+#ifndef _WIN32
+        if (arg == "--shard-server") return runShardServer(argv[i + 1]);
+#endif
+        if (arg == "--fault-test") return runFaultTest(atoi(argv[i + 1]));
+        if (arg == "--bench-kernels") return runKernelBench(atoi(argv[i + 1]));
+        if (arg == "--bench-similar") return runSimilarBench(atoi(argv[i + 1]));
+        if (arg == "--bench-sessions") return runSessionBench(atoi(argv[i + 1]));
+        if (arg == "--bench-admission") return runAdmissionBench(atoi(argv[i + 1]));
+        if (arg == "--bench-memory")
+            return runMemoryBench(atoi(argv[i + 1]),
+                                  i + 2 < argc ? atoi(argv[i + 2]) : (int)max(1u, thread::hardware_concurrency()));
+        if (arg == "--archive" && i + 2 < argc) return runArchive(argv[i + 1], argv[i + 2]);
+        if (arg == "--archive-scan" && i + 4 < argc)
+            return runArchiveScan(argv[i + 1], argv[i + 2], atoi(argv[i + 3]), atoi(argv[i + 4]));
+        if (arg == "--bloom-fp") bloomConfig.fpRate = min(0.5, max(1e-9, atof(argv[++i])));
+        else if (arg == "--bloom-bytes") bloomConfig.zoneBytes = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--hugepages") {
+            string mode = argv[++i];
+            memoryConfig.hugePages = mode == "thp" ? HUGEPAGES_THP : mode == "explicit" ? HUGEPAGES_EXPLICIT : HUGEPAGES_OFF;
+        } else if (arg == "--search-rate") admissionConfig.rate = max(0.01, atof(argv[++i]));
+        else if (arg == "--record") recordPath = argv[++i];
+        else if (arg == "--replay") replayPath = argv[++i];
+        else if (arg == "--speed") replaySpeed = string(argv[++i]) == "max" ? 0 : max(0.0, atof(argv[i]));
+        else if (arg == "--threads") replayThreads = atoi(argv[++i]);
+        else if (arg == "--desc-cache") descCacheBytes = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--query-cache") queryCacheBytes = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--shards") shardCount = atoi(argv[++i]);
+        else if (arg == "--shard-sockets") {
+            stringstream ss(argv[++i]);
+            for (string path; getline(ss, path, ',');) shardSockets.push_back(path);
+        }
+    }
+
+    if (!replayPath.empty()) return runReplay(replayPath, replaySpeed, replayThreads);
+
+    RealEstate app(descCacheBytes, queryCacheBytes);
+    if (descCacheBytes && !app.paging())
+        return 1;
+    if (!recordPath.empty() && !app.startRecording(recordPath))
+        return 1;
+    if ((shardCount > 0 || !shardSockets.empty()) && !app.enableSharding(shardCount, shardSockets))
+        return 1;
+    string token; // this terminal's session
     int option;
 
     do {
-        if (loggedUser.empty()) {
+        shared_ptr<Session> session = token.empty() ? nullptr : app.session(token);
+        if (!token.empty() && !session) {
+            cout << YELLOW << "Your session has expired; please log in again.\n" << RESET;
+            token.clear();
+        }
+        if (!session) {
             cout << BOLD << CYAN << "\n=== Real Estate Property Search ===\n" << RESET;
             cout << YELLOW << "1. Show All Properties (Sorted by Price)\n";
             cout << GREEN<<"2. Search Property\n";
             cout << RED<<"3. Register\n";
             cout << BLUE<<"4. Login\n";
-            cout << MAGENTA<<"5. Exit\n" << RESET;
+            cout << MAGENTA<<"5. Exit\n";
+            cout << CYAN<<"6. Statistics\n" << RESET;
             cout << WHITE << "Enter your choice: " << RESET;
             cin >> option;
 
             switch (option) {
-                case 1: app.showAllProperties(); break;
-                case 2: app.searchProperty(); break;
+                case 1: app.showAllProperties(nullptr); break;
+                case 2: app.searchProperty(nullptr); break;
                 case 3: app.registerUser(); break;
-                case 4: app.loginUser(loggedUser); break;
+                case 4: app.loginUser(token); break;
                 case 5: cout << GREEN << "Exiting...\n" << RESET; break;
+                case 6: app.showStatistics(); break;
                 default: cout << RED << "Invalid option!\n" << RESET;
             }
         } else {
+            const string &loggedUser = session->user;
             cout << BOLD << CYAN << "\n=== Welcome, " << loggedUser << " ===\n" << RESET;
+            if (size_t pending = app.pendingNotifications(loggedUser))
+                cout << YELLOW << "You have " << pending << " new notification(s).\n" << RESET;
             cout << YELLOW << "1. Add Property\n";
             cout << RED<<"2. Show All Properties (Sorted by Price)\n";
             cout << GREEN<<"3. Search Property\n";
             cout << CYAN<<"4. Show My Properties\n";
-            cout << RED<<"5. Logout\n" << RESET;
+            cout << RED<<"5. Logout\n";
+            cout << MAGENTA<<"6. Export Properties (CSV)\n";
+            cout << CYAN<<"7. Statistics\n";
+            cout << YELLOW<<"8. Edit Property\n";
+            cout << RED<<"9. Delete Property\n";
+            cout << GREEN<<"10. Saved Searches\n";
+            cout << MAGENTA<<"11. Notifications\n" << RESET;
             cout << WHITE << "Enter your choice: " << RESET;
             cin >> option;
 
             switch (option) {
-                case 1: app.addProperty(loggedUser); break;
-                case 2: app.showAllProperties(); break;
-                case 3: app.searchProperty(); break;
-                case 4: app.showMyProperties(loggedUser); break;
-                case 5: loggedUser = ""; cout << GREEN << "Logged out successfully!\n" << RESET; break;
+                case 1: app.addProperty(*session); break;
+                case 2: app.showAllProperties(session.get()); break;
+                case 3: app.searchProperty(session.get()); break;
+                case 4: app.showMyProperties(*session); break;
+                case 5:
+                    app.logout(token);
+                    token.clear();
+                    cout << GREEN << "Logged out successfully!\n" << RESET;
+                    break;
+                case 6: app.exportPropertiesMenu(); break;
+                case 7: app.showStatistics(); break;
+                case 8: app.updateProperty(*session); break;
+                case 9: app.deleteProperty(*session); break;
+                case 10: app.savedSearchesMenu(loggedUser); break;
+                case 11: app.showNotifications(loggedUser); break;
                 default: cout << RED << "Invalid option!\n" << RESET;
             }
         }
-    } while (option != 5 || !loggedUser.empty());
+    } while (option != 5 || !token.empty());
 
     return 0;
 }
\ No newline at end of file
@@ -12,6 +12,12 @@
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <io.h>
 
 #pragma comment(lib, "comctl32.lib")
 
@@ -73,13 +79,52 @@ std::vector<HWND> registerControls;
 std::vector<HWND> searchControls;
 std::vector<HWND> addPropertyControls;
 
-std::vector<std::tuple<std::string, std::string, int, int, std::string>> properties; // type, location, price, area, owner
+// type, location, price, area, owner, then lat, lon and id kept verbatim so the
+// console program's id-keyed files (descriptions, price history) still match;
+// listings added here have an empty id and are numbered by the console program.
+std::vector<std::tuple<std::string, std::string, int, int, std::string, std::string, std::string, std::string>> properties;
 const char *PROPERTY_FILE = "properties.csv";
 const char *USER_FILE = "users.csv";
+std::vector<std::string> rejectedLines; // "line N: text" for rows LoadProperties could not parse
+
+// Bloom filter over usernames: UserExists/ValidateUser only read users.csv
+// when it answers "maybe". 64 Ki bits (8 KB) with 7 hashes keeps false
+// positives near 1% up to ~6,800 users; raise USER_BLOOM_BITS for more.
+const size_t USER_BLOOM_BITS = 1 << 16;
+const int USER_BLOOM_HASHES = 7;
+std::vector<unsigned long long> userBloom(USER_BLOOM_BITS / 64);
+
+// Zone maps: min/max price of each ZONE_ROWS-row block of `properties`, so
+// range searches skip blocks that cannot match. Rebuilt whenever the
+// vector changes.
+const int ZONE_ROWS = 256;
+std::vector<std::pair<int, int>> priceZones;
 
 bool isLoggedIn = false;
 std::string currentUser = "";
 
+// Background writer: saves are queued here so the message loop never waits
+// on the disk. A job for a file that already has one queued is folded into
+// it (a rewrite replaces the queued data, an append extends it). Every
+// write is flushed to the disk before it counts as done; rewrites go to a
+// temp file that is synced and then swapped in by MoveFileExA with
+// write-through, so neither a crash nor a power cut leaves a half-written
+// CSV.
+struct WriteJob
+{
+    std::string path;
+    std::string data;
+    bool append;
+};
+
+const size_t WRITE_QUEUE_LIMIT = 64;
+std::deque<WriteJob> writeQueue;
+bool writerBusy = false, writerStopping = false;
+std::mutex writerMutex;
+std::condition_variable writerSignal;
+std::thread writerThread;
+WriteJob currentJob; // the job being written while writerBusy; set under writerMutex
+
 // Utils
 std::string ToUpper(const std::string &s) {
     std::string r = s;
@@ -87,93 +132,241 @@ std::string ToUpper(const std::string &s) {
     return r;
 }
 
+void RebuildZoneMaps()
+{
+    priceZones.clear();
+    for (int i = 0; i < (int)properties.size(); ++i)
+    {
+        int p = std::get<2>(properties[i]);
+        if (i % ZONE_ROWS == 0)
+            priceZones.emplace_back(p, p);
+        priceZones.back().first = std::min(priceZones.back().first, p);
+        priceZones.back().second = std::max(priceZones.back().second, p);
+    }
+}
+
 void LoadProperties() {
     properties.clear();
+    rejectedLines.clear();
     std::ifstream fin(PROPERTY_FILE);
     if (!fin.is_open())
         return;
     std::string line;
+    int lineNo = 0;
     while (std::getline(fin, line))
     {
+        ++lineNo;
         if (line.empty())
             continue;
         std::stringstream ss(line);
-        std::string t, loc, priceS, areaS, owner;
+        std::string t, loc, priceS, areaS, owner, lat, lon, id;
         std::getline(ss, t, ',');
         std::getline(ss, loc, ',');
         std::getline(ss, priceS, ',');
         std::getline(ss, areaS, ',');
         std::getline(ss, owner, ',');
+        std::getline(ss, lat, ',');
+        std::getline(ss, lon, ',');
+        std::getline(ss, id, ',');
         try
         {
             int price = std::stoi(priceS);
             int area = std::stoi(areaS);
-            properties.emplace_back(t, loc, price, area, owner);
+            properties.emplace_back(t, loc, price, area, owner, lat, lon, id);
         }
         catch (...)
-        { /* skip invalid Lines*/
+        {
+            rejectedLines.push_back("line " + std::to_string(lineNo) + ": " + line);
         }
     }
     fin.close();
+    RebuildZoneMaps();
 }
 
-// User management functions
-void SaveUser(const std::string &username, const std::string &password)
+// Background writer
+// Writes (text mode, like the readers expect) and forces the data out of
+// the OS cache with _commit, i.e. FlushFileBuffers.
+bool WriteSynced(const std::string &path, const std::string &data, bool append)
 {
-    std::ofstream fout(USER_FILE, std::ios::app);
-    fout << username << "," << password << "\n";
-    fout.close();
+    FILE *f = fopen(path.c_str(), append ? "a" : "w");
+    if (!f)
+        return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size() && fflush(f) == 0 && _commit(_fileno(f)) == 0;
+    return fclose(f) == 0 && ok;
 }
 
-bool ValidateUser(const std::string &username, const std::string &password)
+bool PerformWrite(const WriteJob &job)
 {
-    std::ifstream fin(USER_FILE);
-    if (!fin.is_open())
+    if (job.append)
+        return WriteSynced(job.path, job.data, true);
+    std::string tmp = job.path + ".tmp";
+    if (!WriteSynced(tmp, job.data, false))
         return false;
+    return MoveFileExA(tmp.c_str(), job.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
 
-    std::string line;
-    while (std::getline(fin, line))
+void WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    while (true)
     {
-        if (line.empty())
+        writerSignal.wait(lock, [] { return writerStopping || !writeQueue.empty(); });
+        if (writeQueue.empty())
+            return; // stopping, and drained
+        currentJob = std::move(writeQueue.front());
+        writeQueue.pop_front();
+        writerBusy = true;
+        writerSignal.notify_all();
+        lock.unlock();
+        PerformWrite(currentJob); // only this thread changes currentJob
+        lock.lock();
+        writerBusy = false;
+        currentJob = WriteJob();
+        writerSignal.notify_all();
+    }
+}
+
+void QueueWrite(const std::string &path, std::string data, bool append)
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    for (auto &job : writeQueue)
+    {
+        if (job.path != path)
             continue;
-        std::stringstream ss(line);
-        std::string user, pass;
-        std::getline(ss, user, ',');
-        std::getline(ss, pass, ',');
-        if (user == username && pass == password)
+        if (append)
+            job.data += data;
+        else
         {
-            fin.close();
-            return true;
+            job.data = std::move(data);
+            job.append = false;
         }
+        return;
     }
-    fin.close();
-    return false;
+    writerSignal.wait(lock, [] { return writeQueue.size() < WRITE_QUEUE_LIMIT; });
+    writeQueue.push_back({path, std::move(data), append});
+    writerSignal.notify_all();
 }
 
-bool UserExists(const std::string &username)
+// Data queued for (or being written to) `path` that the file may not show
+// yet. Lets readers on the UI thread see their own saves without waiting
+// for the disk.
+std::string PendingWrites(const std::string &path)
 {
-    std::ifstream fin(USER_FILE);
-    if (!fin.is_open())
-        return false;
+    std::lock_guard<std::mutex> lock(writerMutex);
+    std::string data;
+    if (writerBusy && currentJob.path == path)
+        data += currentJob.data;
+    for (auto &job : writeQueue)
+        if (job.path == path)
+            data += job.data;
+    return data;
+}
 
+void StartWriter()
+{
+    writerThread = std::thread(WriterLoop);
+}
+
+// Drains the queue, then stops the writer thread.
+void StopWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writerStopping = true;
+    }
+    writerSignal.notify_all();
+    if (writerThread.joinable())
+        writerThread.join();
+}
+
+// User management functions
+unsigned long long UserBloomHash(const std::string &name)
+{
+    unsigned long long h = 1469598103934665603ULL;
+    for (unsigned char c : name)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void UserBloomAdd(const std::string &name)
+{
+    unsigned long long h = UserBloomHash(name), step = (h >> 32) | 1;
+    for (int i = 0; i < USER_BLOOM_HASHES; ++i, h += step)
+        userBloom[(h % USER_BLOOM_BITS) / 64] |= 1ULL << (h % 64);
+}
+
+// False means the user definitely does not exist.
+bool UserMayExist(const std::string &name)
+{
+    unsigned long long h = UserBloomHash(name), step = (h >> 32) | 1;
+    for (int i = 0; i < USER_BLOOM_HASHES; ++i, h += step)
+        if (!(userBloom[(h % USER_BLOOM_BITS) / 64] >> (h % 64) & 1))
+            return false;
+    return true;
+}
+
+void LoadUserBloom()
+{
+    std::ifstream fin(USER_FILE);
     std::string line;
     while (std::getline(fin, line))
     {
-        if (line.empty())
-            continue;
         std::stringstream ss(line);
         std::string user;
         std::getline(ss, user, ',');
-        if (user == username)
+        if (!user.empty())
+            UserBloomAdd(user);
+    }
+}
+
+void SaveUser(const std::string &username, const std::string &password)
+{
+    UserBloomAdd(username);
+    QueueWrite(USER_FILE, username + "," + password + "\n", true);
+}
+
+// Looks for the user (and, if given, the password) in users.csv and in
+// the registrations still waiting in the write queue. The queue is read
+// first: a job that finishes meanwhile is then in the file.
+bool FindUser(const std::string &username, const std::string *password)
+{
+    std::istringstream pending(PendingWrites(USER_FILE));
+    std::ifstream fin(USER_FILE);
+    std::istream *sources[] = {&pending, &fin};
+    for (std::istream *in : sources)
+    {
+        std::string line;
+        while (std::getline(*in, line))
         {
-            fin.close();
-            return true;
+            if (line.empty())
+                continue;
+            std::stringstream ss(line);
+            std::string user, pass;
+            std::getline(ss, user, ',');
+            std::getline(ss, pass, ',');
+            if (user == username && (!password || pass == *password))
+                return true;
         }
     }
-    fin.close();
     return false;
 }
 
+bool ValidateUser(const std::string &username, const std::string &password)
+{
+    return UserMayExist(username) && FindUser(username, &password);
+}
+
+bool UserExists(const std::string &username)
+{
+    return UserMayExist(username) && FindUser(username, nullptr);
+}
+
 // Section visibility management
 void HideAllControls(const std::vector<HWND> &controls)
 {
@@ -235,13 +428,14 @@ void SwitchToSection(int section)
 
 void SaveProperties()
 {
-    std::ofstream fout(PROPERTY_FILE);
+    std::ostringstream out;
     for (auto &p : properties)
     {
-        fout << std::get<0>(p) << "," << std::get<1>(p) << "," << std::get<2>(p) << ","
-            << std::get<3>(p) << "," << std::get<4>(p) << "\n";
+        out << std::get<0>(p) << "," << std::get<1>(p) << "," << std::get<2>(p) << ","
+            << std::get<3>(p) << "," << std::get<4>(p) << "," << std::get<5>(p) << ","
+            << std::get<6>(p) << "," << std::get<7>(p) << "\n";
     }
-    fout.close();
+    QueueWrite(PROPERTY_FILE, out.str(), false);
 }
 
 
@@ -258,6 +452,7 @@ void BubbleSortByPrice()
             }
         }
     }
+    RebuildZoneMaps();
 }
 
 
@@ -425,7 +620,8 @@ void OnAddProperty(HWND hWnd)
         int area = std::stoi(areaS);
         type = ToUpper(type);
         loc = ToUpper(loc);
-        properties.emplace_back(type, loc, price, area, owner);
+        properties.emplace_back(type, loc, price, area, owner, "", "", "");
+        RebuildZoneMaps();
         SaveProperties();
         MessageBoxA(hWnd, "Property added successfully.", "Success", MB_ICONINFORMATION);
 
@@ -528,11 +724,17 @@ void OnSearchByRange(HWND hWnd)
         int minP = std::stoi(inputMin);
         int maxP = std::stoi(inputMax);
         std::vector<int> results;
-        for (int i = 0; i < (int)properties.size(); ++i)
+        for (int z = 0; z < (int)priceZones.size(); ++z)
         {
-            int p = std::get<2>(properties[i]);
-            if (p >= minP && p <= maxP)
-                results.push_back(i);
+            if (priceZones[z].first > maxP || priceZones[z].second < minP)
+                continue;
+            int end = std::min((z + 1) * ZONE_ROWS, (int)properties.size());
+            for (int i = z * ZONE_ROWS; i < end; ++i)
+            {
+                int p = std::get<2>(properties[i]);
+                if (p >= minP && p <= maxP)
+                    results.push_back(i);
+            }
         }
         if (results.empty())
             MessageBoxA(hWnd, "No matching properties found.", "Info", MB_OK);
@@ -795,8 +997,16 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         InitListViewColumns(hListView);
 
         // Load existing properties
+        LoadUserBloom();
         LoadProperties();
         RefreshListViewAll(hListView);
+        if (!rejectedLines.empty())
+        {
+            std::string msg = "Skipped " + std::to_string(rejectedLines.size()) + " invalid line(s) in " + PROPERTY_FILE + ":\n";
+            for (size_t i = 0; i < rejectedLines.size() && i < 10; ++i)
+                msg += rejectedLines[i] + "\n";
+            MessageBoxA(hWnd, msg.c_str(), "Load Warning", MB_ICONWARNING);
+        }
 
         // Start with LOGIN section visible
         SwitchToSection(IDC_BTN_SECTION_LOGIN);
@@ -864,6 +1074,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_DESTROY:
+        StopWriter();
         PostQuitMessage(0);
         break;
 
@@ -888,6 +1099,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     wc.hIcon = LoadIcon(NULL, IDI_APPLICATION);
 
     RegisterClassA(&wc);
+    StartWriter();
 
     HWND hWnd = CreateWindowExA(0, CLASS_NAME, "Real Estate Management System",
                                 WS_OVERLAPPEDWINDOW & ~WS_THICKFRAME, // not resizable